@@ -0,0 +1,81 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_ALIGNEDALLOCATOR_H_
+#define SRC_ALIGNEDALLOCATOR_H_
+
+#include <stdlib.h>
+
+#include <cstddef>
+#include <new>
+
+namespace computer_graphics {
+
+//! \class AlignedAllocator
+//! \brief An allocator for standard containers whose storage starts on an
+//!        Alignment-byte boundary.
+//!
+//! Used for buffers that are scanned with vector instructions, so that rows
+//! can start on a cache line.
+template <typename T, size_t Alignment = 64>
+class AlignedAllocator {
+  public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind {
+      typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {
+    }
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {
+    }
+
+    pointer address(reference value) const { return &value; }
+    const_pointer address(const_reference value) const { return &value; }
+
+    size_type max_size() const { return static_cast<size_t>(-1) / sizeof(T); }
+
+    pointer allocate(size_type n, const void* = 0) {
+      void* memory = NULL;
+      if (posix_memalign(&memory, Alignment, n * sizeof(T)) != 0) {
+        throw std::bad_alloc();
+      }
+      return static_cast<pointer>(memory);
+    }
+
+    void deallocate(pointer p, size_type) {
+      free(p);
+    }
+
+    void construct(pointer p, const T& value) {
+      new(p) T(value);
+    }
+
+    void destroy(pointer p) {
+      p->~T();
+    }
+};
+
+template <typename T, typename U, size_t Alignment>
+inline bool operator==(const AlignedAllocator<T, Alignment>&,
+    const AlignedAllocator<U, Alignment>&) {
+  return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+inline bool operator!=(const AlignedAllocator<T, Alignment>&,
+    const AlignedAllocator<U, Alignment>&) {
+  return false;
+}
+}  // namespace computer_graphics
+
+#endif  // SRC_ALIGNEDALLOCATOR_H_
@@ -0,0 +1,194 @@
+//! \author Stephen McGruer
+
+#include "./anti_aliasing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "./job_system.h"
+
+namespace computer_graphics {
+
+namespace {
+//! The number of rows that each job filters.
+const int kRowsPerJob = 16;
+
+//! The contrast that FXAA needs to see an edge, relative to the brightest
+//! luma around the pixel, and at the least.
+const float kFxaaEdgeThreshold = 0.125f;
+const float kFxaaEdgeThresholdMin = 0.0312f;
+
+//! The most that FXAA blends a pixel with its neighbour.
+const float kFxaaSubpixelQuality = 0.75f;
+
+inline float Luma(const float* pixel) {
+  return 0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2];
+}
+
+//! \brief Filters a row of width pixels with the cross filter, given the
+//!        original rows before, at and after it, and writes it to out.
+//!
+//! The original rows are padded with one pixel on either side.
+void CrossFilterRow(const float* previous, const float* row,
+    const float* next, int width, float* out) {
+  for (int i = 0; i < width * 3; i++) {
+    out[i] = (row[i + 3] + row[i] + previous[i + 3] + row[i + 6] +
+        next[i + 3]) / 5.0f;
+  }
+}
+
+//! Filters a row with the FXAA filter. See CrossFilterRow().
+void FxaaFilterRow(const float* previous, const float* row,
+    const float* next, int width, float* out) {
+  for (int x = 0; x < width; x++) {
+    const int i = 3 * (x + 1);
+    const float* centre = row + i;
+    std::copy(centre, centre + 3, out + 3 * x);
+
+    const float luma = Luma(centre);
+    const float luma_west = Luma(row + i - 3);
+    const float luma_east = Luma(row + i + 3);
+    const float luma_previous = Luma(previous + i);
+    const float luma_next = Luma(next + i);
+    const float highest = std::max(luma, std::max(
+        std::max(luma_west, luma_east), std::max(luma_previous, luma_next)));
+    const float lowest = std::min(luma, std::min(
+        std::min(luma_west, luma_east), std::min(luma_previous, luma_next)));
+    const float range = highest - lowest;
+    if (range < std::max(kFxaaEdgeThresholdMin,
+        highest * kFxaaEdgeThreshold)) {
+      continue;
+    }
+
+    const float luma_previous_west = Luma(previous + i - 3);
+    const float luma_previous_east = Luma(previous + i + 3);
+    const float luma_next_west = Luma(next + i - 3);
+    const float luma_next_east = Luma(next + i + 3);
+
+    // An edge along the row has luma changing sharply from row to row.
+    const float across_rows =
+        2.0f * std::fabs(luma_previous + luma_next - 2.0f * luma) +
+        std::fabs(luma_previous_west + luma_next_west - 2.0f * luma_west) +
+        std::fabs(luma_previous_east + luma_next_east - 2.0f * luma_east);
+    const float across_columns =
+        2.0f * std::fabs(luma_west + luma_east - 2.0f * luma) +
+        std::fabs(luma_previous_west + luma_previous_east -
+            2.0f * luma_previous) +
+        std::fabs(luma_next_west + luma_next_east - 2.0f * luma_next);
+
+    // Blend with the neighbour on the steeper side of the edge.
+    const float* neighbour;
+    if (across_rows >= across_columns) {
+      neighbour = (std::fabs(luma_previous - luma) >=
+          std::fabs(luma_next - luma)) ? previous + i : next + i;
+    } else {
+      neighbour = (std::fabs(luma_west - luma) >=
+          std::fabs(luma_east - luma)) ? row + i - 3 : row + i + 3;
+    }
+
+    const float average = (2.0f * (luma_previous + luma_next + luma_west +
+        luma_east) + luma_previous_west + luma_previous_east +
+        luma_next_west + luma_next_east) / 12.0f;
+    float blend = std::min(std::fabs(average - luma) / range, 1.0f);
+    blend = (3.0f - 2.0f * blend) * blend * blend;
+    blend = blend * blend * kFxaaSubpixelQuality;
+    for (int c = 0; c < 3; c++) {
+      out[3 * x + c] = centre[c] + (neighbour[c] - centre[c]) * blend;
+    }
+  }
+}
+
+//! \brief Filters the visible rows of the framebuffer in place with
+//!        filter_row, which is given padded copies of the original rows.
+//!
+//! Pixels beyond the left and top of the window are black, or copies of
+//! the nearest pixels if replicate_edges is set. The right column and
+//! bottom row of the framebuffer lie beyond the visible part, and are read
+//! but not filtered.
+template <typename RowFilter>
+void FilterInPlace(Framebuffer& framebuffer, bool replicate_edges,
+    RowFilter filter_row) {
+  const int top = framebuffer.window_info().top;
+  const int width = framebuffer.width() - 1;
+  const int height = framebuffer.height() - 1;
+  const int padded = (width + 2) * 3;
+
+  // Copies the original row (relative to the top) into a padded buffer.
+  auto copy_row = [&](int row, float* out) {
+    if (row < 0) {
+      if (!replicate_edges) {
+        std::fill(out, out + padded, 0.0f);
+        return;
+      }
+      row = 0;
+    }
+    memcpy(out + 3, framebuffer.colour_row(top + row),
+        (width + 1) * 3 * sizeof(float));
+    for (int c = 0; c < 3; c++) {
+      out[c] = replicate_edges ? out[3 + c] : 0.0f;
+    }
+  };
+
+  // Each band overwrites its first and last rows, which the bands on either
+  // side also read, so the originals of those are kept first.
+  const int num_bands = (height + kRowsPerJob - 1) / kRowsPerJob;
+  std::vector<float> band_edges(num_bands * 2 * padded);
+  for (int band = 0; band < num_bands; band++) {
+    const int begin = band * kRowsPerJob;
+    const int end = std::min(begin + kRowsPerJob, height);
+    copy_row(begin - 1, &band_edges[2 * band * padded]);
+    copy_row(end, &band_edges[(2 * band + 1) * padded]);
+  }
+
+  Jobs().ParallelForBlocks(height, kRowsPerJob, [&](int begin, int end) {
+    const float* edges = &band_edges[2 * (begin / kRowsPerJob) * padded];
+    std::vector<float> rows(3 * padded);
+    float* previous = &rows[0];
+    float* current = &rows[padded];
+    float* next = &rows[2 * padded];
+    std::copy(edges, edges + padded, previous);
+    copy_row(begin, current);
+    for (int row = begin; row < end; row++) {
+      if (row + 1 == end) {
+        std::copy(edges + padded, edges + 2 * padded, next);
+      } else {
+        copy_row(row + 1, next);
+      }
+      filter_row(previous, current, next, width,
+          framebuffer.colour_row(top + row));
+
+      std::swap(previous, current);
+      std::swap(current, next);
+    }
+  });
+}
+}  // namespace
+
+const char* AntiAliasingFilterName(AntiAliasingFilter filter) {
+  switch (filter) {
+    case kNoAntiAliasing:
+      return "none";
+    case kCrossFilter:
+      return "cross";
+    case kFxaaFilter:
+      return "fxaa";
+    default:
+      return "unknown";
+  }
+}
+
+void AntiAlias(AntiAliasingFilter filter, Framebuffer& framebuffer) {
+  switch (filter) {
+    case kCrossFilter:
+      FilterInPlace(framebuffer, false, CrossFilterRow);
+      break;
+    case kFxaaFilter:
+      FilterInPlace(framebuffer, true, FxaaFilterRow);
+      break;
+    default:
+      break;
+  }
+}
+}  // namespace computer_graphics
@@ -0,0 +1,41 @@
+//! \author Stephen McGruer
+
+// Post-process anti-aliasing filters for finished frames.
+
+#ifndef SRC_ANTIALIASING_H_
+#define SRC_ANTIALIASING_H_
+
+#include "./framebuffer.h"
+
+namespace computer_graphics {
+
+//! The anti-aliasing filters that can be applied to a finished frame.
+enum AntiAliasingFilter {
+  kNoAntiAliasing,
+  kCrossFilter,  //!< Averages each pixel with its four neighbours.
+  kFxaaFilter,   //!< Blends pixels across the edges they lie on.
+  kNumAntiAliasingFilters,
+};
+
+//! Returns the human-readable name of an anti-aliasing filter.
+const char* AntiAliasingFilterName(AntiAliasingFilter filter);
+
+//! \brief Applies an anti-aliasing filter to the visible part of the
+//!        framebuffer's colour plane, in place.
+//!
+//! The cross filter averages each pixel with the pixels on either side of
+//! it and above and below it, taking those outside the window as black.
+//!
+//! The FXAA filter follows the edge detection and sub-pixel blending of
+//! Timothy Lottes' FXAA. A pixel is only changed if the contrast in luma
+//! around it is high enough to be an edge. It is then blended with the
+//! neighbour across the edge, by how much it stands out from its
+//! neighbourhood, so that textures and smooth shading stay sharp. FXAA's
+//! search along the edge for its ends is left out, so that only the rows
+//! next to each row are needed.
+//!
+//! Bands of rows are filtered in parallel on the shared job system.
+void AntiAlias(AntiAliasingFilter filter, Framebuffer& framebuffer);
+}  // namespace computer_graphics
+
+#endif  // SRC_ANTIALIASING_H_
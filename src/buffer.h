@@ -0,0 +1,140 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_BUFFER_H_
+#define SRC_BUFFER_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "./aligned_allocator.h"
+
+namespace computer_graphics {
+
+//! \class Buffer
+//! \brief A contiguous array that either owns its elements, or views
+//!        elements that belong to something else, such as a memory-mapped
+//!        file.
+//!
+//! Owned elements are aligned for vector instructions. A view keeps the
+//! memory it refers to alive. Its elements are written in place, so that
+//! memory must be private to the view, as a MappedFile's is; resizing a view
+//! first copies its elements into owned storage. Copying a buffer always
+//! makes an owning copy, so writes to the copy cannot reach the original.
+template <typename T>
+class Buffer {
+  public:
+    Buffer()
+        : data_(NULL),
+          size_(0) {
+    }
+
+    Buffer(const Buffer& other)
+        : data_(NULL),
+          size_(0) {
+      *this = other;
+    }
+
+    Buffer(Buffer&& other)
+        : data_(NULL),
+          size_(0) {
+      *this = std::move(other);
+    }
+
+    Buffer& operator=(const Buffer& other) {
+      if (this != &other) {
+        storage_.assign(other.data_, other.data_ + other.size_);
+        owner_.reset();
+        Own();
+      }
+      return *this;
+    }
+
+    Buffer& operator=(Buffer&& other) {
+      if (this != &other) {
+        // Moving a vector keeps its storage, so data_ can be carried over.
+        storage_ = std::move(other.storage_);
+        owner_ = std::move(other.owner_);
+        data_ = other.data_;
+        size_ = other.size_;
+        other.storage_.clear();
+        other.Own();
+      }
+      return *this;
+    }
+
+    //! \brief Returns a buffer that views size elements at data, which owner
+    //!        keeps alive.
+    static Buffer View(T* data, size_t size,
+        const std::shared_ptr<const void>& owner) {
+      Buffer buffer;
+      buffer.data_ = data;
+      buffer.size_ = size;
+      buffer.owner_ = owner;
+      return buffer;
+    }
+
+    inline bool is_view() const { return owner_ != NULL; }
+    inline size_t size() const { return size_; }
+    inline bool empty() const { return size_ == 0; }
+
+    inline const T* data() const { return data_; }
+    inline T* data() { return data_; }
+
+    inline const T& operator[](size_t i) const { return data_[i]; }
+    inline T& operator[](size_t i) { return data_[i]; }
+
+    inline const T* begin() const { return data_; }
+    inline const T* end() const { return data_ + size_; }
+
+    void resize(size_t size, const T& value = T()) {
+      Detach();
+      storage_.resize(size, value);
+      Own();
+    }
+
+    void reserve(size_t size) {
+      Detach();
+      storage_.reserve(size);
+      Own();
+    }
+
+    void push_back(const T& value) {
+      Detach();
+      storage_.push_back(value);
+      Own();
+    }
+
+    void clear() {
+      storage_.clear();
+      owner_.reset();
+      Own();
+    }
+
+  private:
+    //! Copies a view into owned storage.
+    inline void Detach() {
+      if (owner_ != NULL) {
+        storage_.assign(data_, data_ + size_);
+        owner_.reset();
+        Own();
+      }
+    }
+
+    //! Points at the owned storage.
+    inline void Own() {
+      data_ = storage_.data();
+      size_ = storage_.size();
+    }
+
+    std::vector<T, AlignedAllocator<T> > storage_;
+    T* data_;
+    size_t size_;
+
+    //! Keeps the memory of a view alive; NULL for owned elements.
+    std::shared_ptr<const void> owner_;
+};
+}  // namespace computer_graphics
+
+#endif  // SRC_BUFFER_H_
@@ -0,0 +1,76 @@
+//! \author Stephen McGruer
+
+#include "./depth_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace computer_graphics {
+
+const float DepthBuffer::kClearDepth = -1000.0f;
+
+DepthBuffer::DepthBuffer()
+    : window_info_(0, -1, 0, -1),
+      width_(0),
+      height_(0),
+      block_columns_(0) {
+}
+
+DepthBuffer::DepthBuffer(WindowInfo window_info)
+    : window_info_(0, -1, 0, -1),
+      width_(0),
+      height_(0),
+      block_columns_(0) {
+  Resize(window_info);
+  Clear();
+}
+
+void DepthBuffer::Resize(WindowInfo window_info) {
+  window_info_ = window_info;
+  width_ = window_info.right - window_info.left + 1;
+  height_ = window_info.bottom - window_info.top + 1;
+  data_.resize(width_ * height_);
+
+  block_columns_ = (width_ + kBlockSize - 1) / kBlockSize;
+  const int block_rows = (height_ + kBlockSize - 1) / kBlockSize;
+  block_depths_.resize(block_columns_ * block_rows);
+  block_stale_.resize(block_columns_ * block_rows);
+}
+
+//! Only the first row is filled element by element; the rest of the buffer
+//! is copied from it a row at a time.
+void DepthBuffer::Clear() {
+  if (data_.empty()) {
+    return;
+  }
+
+  std::fill(data_.begin(), data_.begin() + width_, kClearDepth);
+  for (int y = 1; y < height_; y++) {
+    memcpy(&data_[y * width_], &data_[0], width_ * sizeof(float));
+  }
+
+  std::fill(block_depths_.begin(), block_depths_.end(), kClearDepth);
+  std::fill(block_stale_.begin(), block_stale_.end(), 0);
+}
+
+float DepthBuffer::UpdateBlockDepth(int column, int row) {
+  const int index = row * block_columns_ + column;
+  if (!block_stale_[index]) {
+    return block_depths_[index];
+  }
+
+  const WindowInfo bounds = block_bounds(column, row);
+  float farthest = depth(bounds.left, bounds.top);
+  for (int y = bounds.top; y <= bounds.bottom; y++) {
+    const float* depths = &data_[(y - window_info_.top) * width_ +
+        (bounds.left - window_info_.left)];
+    for (int x = 0; x <= bounds.right - bounds.left; x++) {
+      farthest = std::min(farthest, depths[x]);
+    }
+  }
+
+  block_depths_[index] = farthest;
+  block_stale_[index] = 0;
+  return farthest;
+}
+}  // namespace computer_graphics
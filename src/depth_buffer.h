@@ -0,0 +1,134 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_DEPTHBUFFER_H_
+#define SRC_DEPTHBUFFER_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "./aligned_allocator.h"
+#include "./teapot_utils.h"
+
+namespace computer_graphics {
+
+//! \class DepthBuffer
+//! \brief A flat depth buffer covering a window.
+//!
+//! Depths are addressed in window coordinates, from (left, top) to
+//! (right, bottom) inclusive, and stored row-major starting from the top
+//! (lowest y) row in a single aligned allocation. Larger depths are closer
+//! to the viewer.
+//!
+//! The buffer is intended to be kept across frames; Resize() only
+//! reallocates when the window size actually changes.
+//!
+//! The buffer also keeps a lower bound on the depths in each kBlockSize
+//! square block of pixels, starting from (left, top), so that the
+//! rasterizer can skip blocks that a triangle is entirely behind. Between
+//! clears, depths may only be raised, or the bounds will be wrong.
+class DepthBuffer {
+  public:
+    //! The depth that the buffer is cleared to; anything in the scene is
+    //! closer than this.
+    static const float kClearDepth;
+
+    //! The width and height of the blocks that bounds are kept for.
+    static const int kBlockSize = 8;
+
+    DepthBuffer();
+    explicit DepthBuffer(WindowInfo window_info);
+
+    //! \brief Sets the window covered by the buffer. The contents are
+    //!        undefined until the next Clear().
+    void Resize(WindowInfo window_info);
+
+    //! Sets every depth in the buffer to kClearDepth.
+    void Clear();
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline const WindowInfo& window_info() const { return window_info_; }
+
+    inline bool Contains(int x, int y) const {
+      return x >= window_info_.left && x <= window_info_.right &&
+          y >= window_info_.top && y <= window_info_.bottom;
+    }
+
+    inline float& depth(int x, int y) {
+      return data_[(y - window_info_.top) * width_ + (x - window_info_.left)];
+    }
+
+    inline float depth(int x, int y) const {
+      return data_[(y - window_info_.top) * width_ + (x - window_info_.left)];
+    }
+
+    //! \brief Returns the start of row y, such that row(y)[i] is the depth
+    //!        at (left + i, y).
+    inline float* row(int y) {
+      return &data_[(y - window_info_.top) * width_];
+    }
+
+    //! Returns the column of blocks that pixel column x lies in.
+    inline int BlockColumn(int x) const {
+      return (x - window_info_.left) / kBlockSize;
+    }
+
+    //! Returns the row of blocks that pixel row y lies in.
+    inline int BlockRow(int y) const {
+      return (y - window_info_.top) / kBlockSize;
+    }
+
+    //! \brief Returns the pixels covered by a block, which are fewer than
+    //!        kBlockSize square at the right and bottom edges of the window.
+    inline WindowInfo block_bounds(int column, int row) const {
+      int left = window_info_.left + column * kBlockSize;
+      int top = window_info_.top + row * kBlockSize;
+      return WindowInfo(left,
+          std::min(left + kBlockSize - 1, window_info_.right), top,
+          std::min(top + kBlockSize - 1, window_info_.bottom));
+    }
+
+    //! \brief Returns a lower bound on the depths in a block.
+    //!
+    //! The bound may be stale, i.e. lower than the farthest depth in the
+    //! block, until UpdateBlockDepth() is called.
+    inline float block_depth(int column, int row) const {
+      return block_depths_[row * block_columns_ + column];
+    }
+
+    //! Returns true if the block's bound may be lower than it needs to be.
+    inline bool block_stale(int column, int row) const {
+      return block_stale_[row * block_columns_ + column] != 0;
+    }
+
+    //! \brief Notes that depths in a block may have been raised, so that its
+    //!        bound may be stale.
+    inline void MarkBlockStale(int column, int row) {
+      block_stale_[row * block_columns_ + column] = 1;
+    }
+
+    //! \brief Raises a block's bound to depth, if that is higher. Every depth
+    //!        in the block must be at least depth.
+    inline void RaiseBlockDepth(int column, int row, float depth) {
+      float& bound = block_depths_[row * block_columns_ + column];
+      bound = std::max(bound, depth);
+    }
+
+    //! \brief Recomputes a block's bound from its depths, if it is stale,
+    //!        and returns it.
+    float UpdateBlockDepth(int column, int row);
+
+  private:
+    WindowInfo window_info_;
+    int width_;
+    int height_;
+
+    std::vector<float, AlignedAllocator<float> > data_;
+
+    int block_columns_;
+    std::vector<float> block_depths_;
+    std::vector<char> block_stale_;
+};
+}  // namespace computer_graphics
+
+#endif  // SRC_DEPTHBUFFER_H_
@@ -0,0 +1,82 @@
+//! \author Stephen McGruer
+
+#include "./frame_writer.h"
+
+#include <opencv/cv.h>
+#include <opencv/highgui.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace computer_graphics {
+
+namespace {
+
+bool EndsWith(const char* str, const char* suffix) {
+  size_t str_length = strlen(str);
+  size_t suffix_length = strlen(suffix);
+  return str_length >= suffix_length &&
+      strcmp(str + str_length - suffix_length, suffix) == 0;
+}
+
+bool WritePPM(const char* filename, const Framebuffer& framebuffer) {
+  FILE* f = fopen(filename, "wb");
+  if (f == NULL) {
+    return false;
+  }
+
+  const WindowInfo& window = framebuffer.window_info();
+  int width = window.right - window.left;
+  int height = window.bottom - window.top;
+  fprintf(f, "P6\n%d %d\n255\n", width, height);
+
+  // Image rows run top-down, whereas window y-coordinates increase upwards.
+  std::vector<unsigned char> row(width * 3);
+  for (int y = window.bottom - 1; y >= window.top; y--) {
+    const float* pixel = framebuffer.colour(window.left, y);
+    for (int i = 0; i < width * 3; i++) {
+      row[i] = ColourToByte(pixel[i]);
+    }
+    fwrite(&row[0], 1, row.size(), f);
+  }
+
+  bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+bool WriteWithOpenCV(const char* filename, const Framebuffer& framebuffer) {
+  const WindowInfo& window = framebuffer.window_info();
+  int width = window.right - window.left;
+  int height = window.bottom - window.top;
+  IplImage* image = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 3);
+
+  // OpenCV stores the image data BGR, not RGB.
+  uchar* data = (uchar *) image->imageData;
+  for (int row = 0; row < height; row++) {
+    const float* pixel =
+        framebuffer.colour(window.left, window.bottom - 1 - row);
+    uchar* out = data + row * image->widthStep;
+    for (int x = 0; x < width; x++) {
+      out[0] = ColourToByte(pixel[2]);
+      out[1] = ColourToByte(pixel[1]);
+      out[2] = ColourToByte(pixel[0]);
+      pixel += 3;
+      out += image->nChannels;
+    }
+  }
+
+  bool ok = cvSaveImage(filename, image) != 0;
+  cvReleaseImage(&image);
+  return ok;
+}
+}  // namespace
+
+bool WriteFrame(const char* filename, const Framebuffer& framebuffer) {
+  if (EndsWith(filename, ".ppm")) {
+    return WritePPM(filename, framebuffer);
+  }
+  return WriteWithOpenCV(filename, framebuffer);
+}
+}  // namespace computer_graphics
@@ -0,0 +1,24 @@
+//! \author Stephen McGruer
+
+// Writes rendered frames to disk.
+
+#ifndef SRC_FRAMEWRITER_H_
+#define SRC_FRAMEWRITER_H_
+
+#include "./framebuffer.h"
+
+namespace computer_graphics {
+
+//! \brief Writes the colour plane of a framebuffer to an image file.
+//!
+//! Only the visible part of the window is written - that is, the pixels
+//! from (left, top) up to but not including (right, bottom), matching what
+//! OpenGL displays. Colours outside of [0, 1] are clamped.
+//!
+//! Files ending in .ppm are written directly as binary PPMs; any other
+//! extension is handed to OpenCV, which picks the format (e.g. PNG) from
+//! the extension. Returns false if the file could not be written.
+bool WriteFrame(const char* filename, const Framebuffer& framebuffer);
+}  // namespace computer_graphics
+
+#endif  // SRC_FRAMEWRITER_H_
@@ -0,0 +1,87 @@
+//! \author Stephen McGruer
+
+#include "./framebuffer.h"
+
+#include <algorithm>
+
+#include "./job_system.h"
+
+namespace computer_graphics {
+
+namespace {
+//! The number of rows that ReadPixels() and Resolve() work on in each job.
+const int kRowsPerJob = 16;
+}  // namespace
+
+Framebuffer::Framebuffer(WindowInfo window_info)
+    : window_info_(window_info),
+      width_(window_info.right - window_info.left + 1),
+      height_(window_info.bottom - window_info.top + 1),
+      colour_(width_ * height_ * 3, 0.0f),
+      depth_buffer_(window_info),
+      samples_(1) {
+}
+
+void Framebuffer::Clear() {
+  std::fill(colour_.begin(), colour_.end(), 0.0f);
+  depth_buffer_.Clear();
+  std::fill(sample_depths_.begin(), sample_depths_.end(),
+      DepthBuffer::kClearDepth);
+  std::fill(sample_colours_.begin(), sample_colours_.end(), 0.0f);
+}
+
+bool Framebuffer::SetSamples(int samples) {
+  if (samples != 1 && samples != 2 && samples != 4 && samples != 8) {
+    return false;
+  }
+  samples_ = samples;
+  if (samples == 1) {
+    sample_depths_.clear();
+    sample_colours_.clear();
+  } else {
+    sample_depths_.resize(width_ * height_ * samples);
+    sample_colours_.resize(width_ * height_ * samples * 3);
+  }
+  return true;
+}
+
+void Framebuffer::Resolve() {
+  if (samples_ == 1) {
+    return;
+  }
+
+  const float scale = 1.0f / samples_;
+  Jobs().ParallelForBlocks(height_, kRowsPerJob, [&](int begin, int end) {
+    for (int i = begin * width_; i < end * width_; i++) {
+      const float* sample = &sample_colours_[i * samples_ * 3];
+      float red = 0.0f;
+      float green = 0.0f;
+      float blue = 0.0f;
+      for (int j = 0; j < samples_; j++, sample += 3) {
+        red += sample[0];
+        green += sample[1];
+        blue += sample[2];
+      }
+      colour_[i * 3] = red * scale;
+      colour_[i * 3 + 1] = green * scale;
+      colour_[i * 3 + 2] = blue * scale;
+    }
+  });
+}
+
+void Framebuffer::ReadPixels(std::vector<unsigned char>& pixels) const {
+  const int visible_width = width_ - 1;
+  const int visible_height = height_ - 1;
+  pixels.resize(visible_width * visible_height * 3);
+  Jobs().ParallelForBlocks(visible_height, kRowsPerJob,
+      [&](int begin, int end) {
+    for (int row = begin; row < end; row++) {
+      const float* colour = &colour_[row * width_ * 3];
+      unsigned char* out = &pixels[row * visible_width * 3];
+      for (int i = 0; i < visible_width * 3; i++) {
+        out[i] = ColourToByte(colour[i]);
+      }
+    }
+  });
+}
+}  // namespace computer_graphics
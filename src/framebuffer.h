@@ -0,0 +1,128 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_FRAMEBUFFER_H_
+#define SRC_FRAMEBUFFER_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "./depth_buffer.h"
+#include "./teapot_utils.h"
+
+namespace computer_graphics {
+
+//! Converts a colour channel to a byte, clamping it to [0, 1].
+inline unsigned char ColourToByte(float value) {
+  value = std::min(std::max(value, 0.0f), 1.0f);
+  return static_cast<unsigned char>(value * 255.0f + 0.5f);
+}
+
+//! \class Framebuffer
+//! \brief A dense colour and depth buffer covering a window.
+//!
+//! Pixels are addressed in window coordinates, i.e. from (left, top) to
+//! (right, bottom) inclusive, as used by the shading algorithms. Both planes
+//! are stored row by row starting from the top (lowest y) row, with the
+//! colour plane holding an RGB triple of floats per pixel.
+//!
+//! For multisample anti-aliasing, the framebuffer can also keep a depth and
+//! a colour for each of several samples per pixel. The rasterizer then
+//! depth tests the samples instead of the depth plane, and copies each
+//! shaded pixel's colour to the samples that it covers. Resolve() averages
+//! them into the colour plane.
+class Framebuffer {
+  public:
+    explicit Framebuffer(WindowInfo window_info);
+
+    //! \brief Clears the colour plane to black and the depth plane to
+    //!        DepthBuffer::kClearDepth, and the samples likewise.
+    void Clear();
+
+    //! \brief Sets the number of samples kept per pixel: 1, or 2, 4 or 8 for
+    //!        multisampling.
+    //!
+    //! Returns false, and leaves the count unchanged, for any other number.
+    //! The samples must be cleared before they are used.
+    bool SetSamples(int samples);
+
+    inline int samples() const { return samples_; }
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline const WindowInfo& window_info() const { return window_info_; }
+
+    inline float& depth(int x, int y) {
+      return depth_buffer_.depth(x, y);
+    }
+
+    inline DepthBuffer& depth_buffer() { return depth_buffer_; }
+
+    inline const float* colour(int x, int y) const {
+      return &colour_[Index(x, y) * 3];
+    }
+
+    //! \brief Returns the start of row y of the colour plane, such that
+    //!        colour_row(y)[3 * i] is the red component at (left + i, y).
+    inline float* colour_row(int y) {
+      return &colour_[Index(window_info_.left, y) * 3];
+    }
+
+    inline void SetColour(int x, int y, float red, float green, float blue) {
+      float* pixel = &colour_[Index(x, y) * 3];
+      pixel[0] = red;
+      pixel[1] = green;
+      pixel[2] = blue;
+    }
+
+    //! \brief Converts the visible part of the colour plane to RGB bytes.
+    //!
+    //! Only the pixels from (left, top) up to but not including (right,
+    //! bottom) are converted, as for WriteFrame(). Rows run from the top
+    //! (lowest y) row, which is the bottom-up order that glDrawPixels()
+    //! expects. The rows are converted in parallel on the shared job system.
+    void ReadPixels(std::vector<unsigned char>& pixels) const;
+
+    //! \brief Returns the depths of the samples of pixel (x, y), when
+    //!        multisampling.
+    inline float* sample_depths(int x, int y) {
+      return &sample_depths_[Index(x, y) * samples_];
+    }
+
+    //! \brief Copies the colour of pixel (x, y) to those of its samples
+    //!        that are set in mask, when multisampling.
+    inline void StoreSamples(int x, int y, int mask) {
+      const float* pixel = &colour_[Index(x, y) * 3];
+      float* sample = &sample_colours_[Index(x, y) * samples_ * 3];
+      for (int i = 0; i < samples_; i++, sample += 3) {
+        if (mask & (1 << i)) {
+          sample[0] = pixel[0];
+          sample[1] = pixel[1];
+          sample[2] = pixel[2];
+        }
+      }
+    }
+
+    //! \brief Sets the colour of each pixel to the average of its samples'
+    //!        colours. Does nothing unless multisampling.
+    void Resolve();
+
+  private:
+    inline int Index(int x, int y) const {
+      return (y - window_info_.top) * width_ + (x - window_info_.left);
+    }
+
+    WindowInfo window_info_;
+    int width_;
+    int height_;
+
+    std::vector<float> colour_;
+    DepthBuffer depth_buffer_;
+
+    //! The samples of each pixel, stored together, when multisampling.
+    int samples_;
+    std::vector<float> sample_depths_;
+    std::vector<float> sample_colours_;
+};
+}  // namespace computer_graphics
+
+#endif  // SRC_FRAMEBUFFER_H_
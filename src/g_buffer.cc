@@ -0,0 +1,26 @@
+//! \author Stephen McGruer
+
+#include "./g_buffer.h"
+
+#include <algorithm>
+
+namespace computer_graphics {
+
+GBuffer::GBuffer()
+    : window_info_(0, -1, 0, -1),
+      width_(0),
+      height_(0) {
+}
+
+void GBuffer::Resize(WindowInfo window_info) {
+  window_info_ = window_info;
+  width_ = window_info.right - window_info.left + 1;
+  height_ = window_info.bottom - window_info.top + 1;
+  materials_.resize(width_ * height_);
+  normals_.resize(width_ * height_ * 3);
+}
+
+void GBuffer::Clear() {
+  std::fill(materials_.begin(), materials_.end(), kNoMaterial);
+}
+}  // namespace computer_graphics
@@ -0,0 +1,88 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_GBUFFER_H_
+#define SRC_GBUFFER_H_
+
+#include <vector>
+
+#include "./teapot_utils.h"
+#include "./vertex.h"
+
+namespace computer_graphics {
+
+//! What a pixel of the G-buffer shows.
+enum GBufferMaterial {
+  kNoMaterial,
+  kObjectMaterial,
+  kFloorMaterial
+};
+
+//! \class GBuffer
+//! \brief The geometry of the visible surface at each pixel of a window,
+//!        for deferred shading.
+//!
+//! Each pixel holds the material of the surface that it shows and, for the
+//! object, its interpolated normal. The depth comes from the depth buffer
+//! that the geometry was rasterized against, and with the pixel's
+//! coordinates gives its position. Pixels are addressed in window
+//! coordinates, and stored row by row starting from the top (lowest y) row.
+//!
+//! The buffer is intended to be kept across frames; Resize() only
+//! reallocates when the window size actually changes.
+class GBuffer {
+  public:
+    GBuffer();
+
+    //! \brief Sets the window covered by the buffer. The contents are
+    //!        undefined until the next Clear().
+    void Resize(WindowInfo window_info);
+
+    //! \brief Sets every pixel's material to kNoMaterial. The normals are
+    //!        left as they are.
+    void Clear();
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline const WindowInfo& window_info() const { return window_info_; }
+
+    inline GBufferMaterial material(int x, int y) const {
+      return static_cast<GBufferMaterial>(materials_[Index(x, y)]);
+    }
+
+    //! \brief Returns the normal of pixel (x, y). Only meaningful for pixels
+    //!        that show the object.
+    inline Vertex normal(int x, int y) const {
+      const float* normal = &normals_[Index(x, y) * 3];
+      return Vertex(normal[0], normal[1], normal[2]);
+    }
+
+    //! Records that pixel (x, y) shows the floor.
+    inline void SetFloor(int x, int y) {
+      materials_[Index(x, y)] = kFloorMaterial;
+    }
+
+    //! Records that pixel (x, y) shows the object, with the given normal.
+    inline void SetObject(int x, int y, float normal_x, float normal_y,
+        float normal_z) {
+      const int index = Index(x, y);
+      materials_[index] = kObjectMaterial;
+      normals_[index * 3] = normal_x;
+      normals_[index * 3 + 1] = normal_y;
+      normals_[index * 3 + 2] = normal_z;
+    }
+
+  private:
+    inline int Index(int x, int y) const {
+      return (y - window_info_.top) * width_ + (x - window_info_.left);
+    }
+
+    WindowInfo window_info_;
+    int width_;
+    int height_;
+
+    std::vector<unsigned char> materials_;
+    std::vector<float> normals_;
+};
+}  // namespace computer_graphics
+
+#endif  // SRC_GBUFFER_H_
@@ -0,0 +1,288 @@
+//! \author Stephen McGruer
+
+#include "./job_system.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace computer_graphics {
+
+//! \class Job
+//! \brief A unit of work, and the bookkeeping needed to schedule it.
+class Job {
+  public:
+    explicit Job(std::function<void()> work)
+        : work_(work),
+          // The extra count on each is released once the job is submitted,
+          // or once it has run, respectively.
+          unmet_dependencies_(1),
+          unfinished_(1),
+          finished_(false) {
+    }
+
+  private:
+    friend class JobSystem;
+
+    std::function<void()> work_;
+
+    //! The job that spawned this one, which cannot finish before it does.
+    JobHandle parent_;
+
+    //! The job is queued when this reaches zero.
+    std::atomic<int> unmet_dependencies_;
+
+    //! The job itself plus its unfinished children.
+    std::atomic<int> unfinished_;
+
+    //! Guards finished_ and dependents_.
+    std::mutex mutex_;
+    bool finished_;
+    std::vector<JobHandle> dependents_;
+};
+
+namespace {
+//! The queue owned by each thread. Threads that are not workers of a job
+//! system share the first queue.
+thread_local int worker_index = 0;
+
+//! The job running on each thread, which becomes the parent of the jobs that
+//! it spawns through ParallelForAsync().
+thread_local JobHandle current_job;
+
+int DefaultJobThreads() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::unique_ptr<JobSystem>& SharedJobSystem() {
+  static std::unique_ptr<JobSystem> jobs(new JobSystem(DefaultJobThreads()));
+  return jobs;
+}
+}  // namespace
+
+JobSystem::JobSystem(int num_threads)
+    : queued_jobs_(0),
+      waiting_threads_(0),
+      stopping_(false) {
+  num_threads = std::max(1, num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    queues_.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+  }
+  for (int i = 1; i < num_threads; i++) {
+    workers_.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  job_queued_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++) {
+    workers_[i].join();
+  }
+}
+
+JobHandle JobSystem::Submit(std::function<void()> work,
+    const std::vector<JobHandle>& dependencies) {
+  JobHandle job(new Job(work));
+  for (size_t i = 0; i < dependencies.size(); i++) {
+    Job* dependency = dependencies[i].get();
+    if (dependency == NULL) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(dependency->mutex_);
+    if (!dependency->finished_) {
+      job->unmet_dependencies_++;
+      dependency->dependents_.push_back(job);
+    }
+  }
+
+  if (--job->unmet_dependencies_ == 0) {
+    Enqueue(job);
+  }
+  return job;
+}
+
+JobHandle JobSystem::ParallelForAsync(int count,
+    std::function<void(int)> body,
+    const std::vector<JobHandle>& dependencies) {
+  const int chunks = std::min(count, 4 * num_threads());
+  return Submit([this, count, body, chunks]() {
+    // Each chunk becomes a child of this job, so that this job does not
+    // finish until they all have.
+    for (int chunk = 0; chunk < chunks; chunk++) {
+      const int begin = static_cast<int64_t>(count) * chunk / chunks;
+      const int end = static_cast<int64_t>(count) * (chunk + 1) / chunks;
+      JobHandle child(new Job([&body, begin, end]() {
+        for (int i = begin; i < end; i++) {
+          body(i);
+        }
+      }));
+      child->parent_ = current_job;
+      current_job->unfinished_++;
+      child->unmet_dependencies_ = 0;
+      Enqueue(child);
+    }
+  }, dependencies);
+}
+
+void JobSystem::ParallelFor(int count,
+    const std::function<void(int)>& body) {
+  if (workers_.empty() || count <= 1) {
+    for (int i = 0; i < count; i++) {
+      body(i);
+    }
+    return;
+  }
+  Wait(ParallelForAsync(count, body));
+}
+
+void JobSystem::ParallelForBlocks(int count, int block_size,
+    const std::function<void(int, int)>& body) {
+  const int blocks = (count + block_size - 1) / block_size;
+  ParallelFor(blocks, [&](int block) {
+    body(block * block_size, std::min(count, (block + 1) * block_size));
+  });
+}
+
+void JobSystem::Wait(const JobHandle& job) {
+  if (job == NULL) {
+    return;
+  }
+
+  while (!Finished(job.get())) {
+    JobHandle other = TakeJob();
+    if (other != NULL) {
+      Execute(other);
+      continue;
+    }
+
+    // Sleep until there is another job to run, or the job is finished.
+    // Finish() wakes the sleepers, so this must count itself as one before
+    // it checks that the job has not finished.
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    waiting_threads_++;
+    while (queued_jobs_ <= 0 && !Finished(job.get())) {
+      job_queued_.wait(lock);
+    }
+    waiting_threads_--;
+  }
+}
+
+void JobSystem::WorkerLoop(int index) {
+  worker_index = index;
+  while (true) {
+    JobHandle job = TakeJob();
+    if (job != NULL) {
+      Execute(job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    while (!stopping_ && queued_jobs_ <= 0) {
+      job_queued_.wait(lock);
+    }
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+void JobSystem::Enqueue(const JobHandle& job) {
+  WorkQueue& queue = *queues_[QueueIndex()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(job);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    queued_jobs_++;
+  }
+  job_queued_.notify_one();
+}
+
+JobHandle JobSystem::TakeJob() {
+  const int own = QueueIndex();
+  for (size_t i = 0; i < queues_.size(); i++) {
+    WorkQueue& queue = *queues_[(own + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+      continue;
+    }
+
+    // Run our own newest job, as its data is most likely still in the
+    // cache, but steal other threads' oldest jobs, which tend to be the
+    // largest.
+    JobHandle job;
+    if (i == 0) {
+      job = queue.jobs.back();
+      queue.jobs.pop_back();
+    } else {
+      job = queue.jobs.front();
+      queue.jobs.pop_front();
+    }
+    queued_jobs_--;
+    return job;
+  }
+  return JobHandle();
+}
+
+void JobSystem::Execute(const JobHandle& job) {
+  JobHandle previous_job = current_job;
+  current_job = job;
+  job->work_();
+  current_job = previous_job;
+
+  if (--job->unfinished_ == 0) {
+    Finish(job.get());
+  }
+}
+
+void JobSystem::Finish(Job* job) {
+  std::vector<JobHandle> dependents;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex_);
+    job->finished_ = true;
+    dependents.swap(job->dependents_);
+  }
+
+  for (size_t i = 0; i < dependents.size(); i++) {
+    if (--dependents[i]->unmet_dependencies_ == 0) {
+      Enqueue(dependents[i]);
+    }
+  }
+
+  if (waiting_threads_ > 0) {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    job_queued_.notify_all();
+  }
+
+  if (job->parent_ != NULL && --job->parent_->unfinished_ == 0) {
+    Finish(job->parent_.get());
+  }
+  job->parent_.reset();
+}
+
+bool JobSystem::Finished(Job* job) {
+  std::lock_guard<std::mutex> lock(job->mutex_);
+  return job->finished_;
+}
+
+int JobSystem::QueueIndex() const {
+  return worker_index < static_cast<int>(queues_.size()) ? worker_index : 0;
+}
+
+JobSystem& Jobs() {
+  return *SharedJobSystem();
+}
+
+void SetJobThreads(int num_threads) {
+  if (num_threads == Jobs().num_threads()) {
+    return;
+  }
+  SharedJobSystem().reset(new JobSystem(num_threads));
+}
+}  // namespace computer_graphics
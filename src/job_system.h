@@ -0,0 +1,121 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_JOBSYSTEM_H_
+#define SRC_JOBSYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace computer_graphics {
+
+class Job;
+
+//! A handle to a submitted job, used to wait on it or depend on it. A
+//! default-constructed handle refers to no job, and counts as finished.
+typedef std::shared_ptr<Job> JobHandle;
+
+//! \class JobSystem
+//! \brief A work-stealing scheduler for running jobs across several threads.
+//!
+//! Every thread has its own queue of jobs. A thread takes the newest job from
+//! its own queue and, when that runs dry, steals the oldest job from another
+//! thread's queue. Threads that are waiting on a job run other jobs in the
+//! meantime, so jobs may themselves submit and wait on jobs.
+//!
+//! A job can depend on other jobs, in which case it is only queued once they
+//! have all finished. A job is not finished until every job it spawned
+//! through ParallelForAsync() has finished as well.
+class JobSystem {
+  public:
+    //! Starts num_threads - 1 workers; the thread waiting on jobs is the last.
+    explicit JobSystem(int num_threads);
+    ~JobSystem();
+
+    inline int num_threads() const { return workers_.size() + 1; }
+
+    //! \brief Queues work to run once all of the dependencies have finished.
+    JobHandle Submit(std::function<void()> work,
+        const std::vector<JobHandle>& dependencies = std::vector<JobHandle>());
+
+    //! \brief Queues body(i) for every i in [0, count), once all of the
+    //!        dependencies have finished.
+    //!
+    //! The range is split into a few chunks per thread. The returned job
+    //! finishes once every index has been run.
+    JobHandle ParallelForAsync(int count, std::function<void(int)> body,
+        const std::vector<JobHandle>& dependencies = std::vector<JobHandle>());
+
+    //! \brief Calls body(i) for every i in [0, count), spread across the
+    //!        threads. Returns once every call has finished.
+    void ParallelFor(int count, const std::function<void(int)>& body);
+
+    //! \brief Calls body(begin, end) for consecutive ranges of at most
+    //!        block_size indices covering [0, count). Returns once every call
+    //!        has finished.
+    //!
+    //! For loops whose bodies work on a run of elements at a time.
+    void ParallelForBlocks(int count, int block_size,
+        const std::function<void(int, int)>& body);
+
+    //! \brief Runs other jobs until the given job has finished, sleeping
+    //!        while there are none to run.
+    void Wait(const JobHandle& job);
+
+  private:
+    //! A queue of jobs that are ready to run, owned by one thread.
+    struct WorkQueue {
+      std::mutex mutex;
+      std::deque<JobHandle> jobs;
+    };
+
+    void WorkerLoop(int index);
+
+    //! Queues a job whose dependencies have all finished.
+    void Enqueue(const JobHandle& job);
+
+    //! Takes a job from this thread's queue, or steals one from another.
+    JobHandle TakeJob();
+
+    //! Runs a job, and finishes it if it did not spawn any children.
+    void Execute(const JobHandle& job);
+
+    //! Called once a job and all of its children have run.
+    void Finish(Job* job);
+
+    //! Returns true if the job has finished.
+    static bool Finished(Job* job);
+
+    //! Returns the queue owned by the calling thread.
+    int QueueIndex() const;
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<WorkQueue> > queues_;
+
+    //! Sleeping threads are woken when jobs are queued, and threads sleeping
+    //! in Wait() also when jobs finish.
+    std::mutex sleep_mutex_;
+    std::condition_variable job_queued_;
+    std::atomic<int> queued_jobs_;
+    std::atomic<int> waiting_threads_;
+    bool stopping_;
+};
+
+//! \brief Returns the job system shared by the transform, shading and
+//!        rasterization passes.
+//!
+//! Starts with one thread per hardware thread.
+JobSystem& Jobs();
+
+//! \brief Replaces the shared job system with one of num_threads threads.
+//!
+//! Must not be called while jobs are running.
+void SetJobThreads(int num_threads);
+}  // namespace computer_graphics
+
+#endif  // SRC_JOBSYSTEM_H_
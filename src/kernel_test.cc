@@ -0,0 +1,297 @@
+//! \author Stephen McGruer
+
+//! A test that the SSE2 and AVX2 span kernels give exactly the same results
+//! as the scalar one. Random triangles of several kinds are set up, and spans
+//! of them are rasterized by each kernel against the same depths; the depths
+//! written and the fragments emitted must match bit for bit. Kernels that the
+//! CPU does not support are skipped.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "./depth_buffer.h"
+#include "./teapot_utils.h"
+#include "./triangle.h"
+#include "./vertex.h"
+#include "./vertex_stream.h"
+#include "./shading/clipper.h"
+#include "./shading/rasterizer.h"
+#include "./shading/shading_utils.h"
+
+namespace cg = computer_graphics;
+
+namespace {
+//! The window that the renderer draws into.
+const cg::WindowInfo kWindow(-320, 320, -240, 240);
+
+//! The number of triangles of each kind that are tested.
+const int kTrianglesPerKind = 1000;
+
+//! The most rows of each triangle that are tested.
+const int kMaxRowsPerTriangle = 12;
+
+//! The kinds of triangle that are tested.
+enum TriangleKind {
+  kOnScreen,     //!< Inside or overlapping the window.
+  kGuardBand,    //!< Reaching out to the guard band.
+  kSliver,       //!< Long and thin, with a nearly collinear vertex.
+  kClipped,      //!< A piece of a triangle clipped to the near plane.
+  kConstantZ,    //!< Drawn at one depth, as flat shading does.
+  kNumTriangleKinds
+};
+
+const char* const kTriangleKindNames[] = {
+  "on-screen", "guard band", "sliver", "clipped", "constant depth"
+};
+
+//! The results of rasterizing one span with one kernel.
+struct SpanResult {
+  std::vector<float> depths;
+  std::vector<cg::Fragment> fragments;
+};
+
+//! Returns true if two floats have the same bits.
+inline bool SameBits(float a, float b) {
+  return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+//! Returns true if two fragments are identical, bit for bit.
+bool SameFragment(const cg::Fragment& a, const cg::Fragment& b) {
+  return a.x == b.x && SameBits(a.z, b.z) && SameBits(a.alpha, b.alpha) &&
+      SameBits(a.beta, b.beta) && SameBits(a.gamma, b.gamma);
+}
+
+//! Rasterizes a span with the given kernel, starting from depths.
+SpanResult RasterizeSpan(cg::SpanKernel kernel, const cg::TriangleSetup& setup,
+    int x, int y, int count, const std::vector<float>& depths) {
+  cg::SetSpanKernel(kernel);
+  const cg::SpanFunction rasterize_span = cg::CurrentSpanFunction();
+
+  SpanResult result;
+  result.depths = depths;
+  result.fragments.resize(cg::kMaxSpanLength);
+  const int e0 = setup.a[0] * x + setup.b[0] * y + setup.c[0];
+  const int e1 = setup.a[1] * x + setup.b[1] * y + setup.c[1];
+  const int e2 = setup.a[2] * x + setup.b[2] * y + setup.c[2];
+  int num_fragments = rasterize_span(setup, x, count, e0, e1, e2,
+      &result.depths[0], &result.fragments[0]);
+  result.fragments.resize(num_fragments);
+  return result;
+}
+
+//! Returns a random vertex in the box (-extent, -extent) to (extent, extent),
+//! at a depth in [near, far].
+cg::Vertex RandomVertex(std::mt19937& random, float extent, float near,
+    float far) {
+  std::uniform_real_distribution<float> xy(-extent, extent);
+  std::uniform_real_distribution<float> z(far, near);
+  return cg::Vertex(xy(random), xy(random), z(random));
+}
+
+//! \brief Sets up a random triangle of the given kind, adding its setups to
+//!        triangles. Returns false if it was culled or rejected.
+bool AddRandomTriangle(TriangleKind kind, std::mt19937& random,
+    std::vector<cg::TriangleSetup>& triangles) {
+  cg::ClippedTriangle clipped;
+  clipped.count = 0;
+  switch (kind) {
+    case kOnScreen:
+    case kConstantZ: {
+      cg::SetupTriangle(RandomVertex(random, 400.0f, -100.0f, -900.0f),
+          RandomVertex(random, 400.0f, -100.0f, -900.0f),
+          RandomVertex(random, 400.0f, -100.0f, -900.0f), kWindow,
+          cg::kCullNone, clipped);
+      if (kind == kConstantZ) {
+        cg::SetConstantDepth(std::uniform_real_distribution<float>(
+            -900.0f, -100.0f)(random), clipped);
+      }
+      break;
+    }
+    case kGuardBand: {
+      // One vertex on screen, so that the triangle is not rejected.
+      cg::SetupTriangle(RandomVertex(random, 200.0f, -100.0f, -900.0f),
+          RandomVertex(random, cg::kGuardBand - 1.0f, -100.0f, -900.0f),
+          RandomVertex(random, cg::kGuardBand - 1.0f, -100.0f, -900.0f),
+          kWindow, cg::kCullNone, clipped);
+      break;
+    }
+    case kSliver: {
+      // The third vertex lies within a pixel of the line through the other
+      // two.
+      cg::Vertex p1 = RandomVertex(random, 2000.0f, -100.0f, -900.0f);
+      cg::Vertex p2 = RandomVertex(random, 2000.0f, -100.0f, -900.0f);
+      std::uniform_real_distribution<float> along(0.0f, 1.0f);
+      std::uniform_real_distribution<float> off(-1.0f, 1.0f);
+      const float t = along(random);
+      cg::Vertex p3(p1[0] + t * (p2[0] - p1[0]) + off(random),
+          p1[1] + t * (p2[1] - p1[1]) + off(random),
+          p1[2] + t * (p2[2] - p1[2]));
+      cg::SetupTriangle(p1, p2, p3, kWindow, cg::kCullNone, clipped);
+      break;
+    }
+    case kClipped: {
+      // A world-space triangle in front of the viewer at the origin, with
+      // one vertex moved behind it, so that it crosses the near plane.
+      cg::VertexStream positions;
+      for (int i = 0; i < 3; i++) {
+        cg::Vertex p = RandomVertex(random, 600.0f, -50.0f, -800.0f);
+        if (i == 0) {
+          p[2] = std::uniform_real_distribution<float>(-0.5f, 300.0f)(random);
+        }
+        positions.push_back(p[0], p[1], p[2]);
+      }
+      const cg::Vertex view(0.0f, 0.0f, 0.0f);
+      cg::VertexStream projected;
+      cg::ProjectPoints(positions, view, kWindow.right - kWindow.left,
+          kWindow.bottom - kWindow.top, projected);
+      if (cg::SetupPerspectiveTriangle(positions, projected,
+          cg::Triangle(0, 1, 2), view, kWindow, cg::kCullNone, clipped) !=
+          cg::kTriangleClipped) {
+        return false;
+      }
+      break;
+    }
+    case kNumTriangleKinds:
+      break;
+  }
+  triangles.insert(triangles.end(), clipped.setups,
+      clipped.setups + clipped.count);
+  return clipped.count > 0;
+}
+
+//! \brief Returns the depths that a span is rasterized against.
+//!
+//! Each is either cleared, or near the triangle's own depth, so that some
+//! pixels pass and some fail. The depth at the triangle's first vertex is
+//! also used as is, as flat triangles then tie with it exactly.
+std::vector<float> RandomDepths(std::mt19937& random,
+    const cg::TriangleSetup& setup, int count) {
+  const float spread = std::abs(setup.dz_beta) + std::abs(setup.dz_gamma) +
+      1.0f;
+  std::uniform_int_distribution<int> choice(0, 3);
+  std::uniform_real_distribution<float> offset(-spread, spread);
+  std::vector<float> depths(count);
+  for (int i = 0; i < count; i++) {
+    switch (choice(random)) {
+      case 0:
+        depths[i] = cg::DepthBuffer::kClearDepth;
+        break;
+      case 1:
+        depths[i] = setup.z;
+        break;
+      default:
+        depths[i] = setup.z + offset(random);
+        break;
+    }
+  }
+  return depths;
+}
+
+//! \brief Checks that a kernel rasterizes a span exactly as the scalar
+//!        kernel does, printing the first few differences.
+bool CheckSpan(cg::SpanKernel kernel, const SpanResult& expected,
+    const cg::TriangleSetup& setup, int x, int y, int count,
+    const std::vector<float>& depths, int& failures) {
+  SpanResult result = RasterizeSpan(kernel, setup, x, y, count, depths);
+  bool same = result.fragments.size() == expected.fragments.size();
+  for (size_t i = 0; same && i < result.fragments.size(); i++) {
+    same = SameFragment(result.fragments[i], expected.fragments[i]);
+  }
+  for (int i = 0; same && i < count; i++) {
+    same = SameBits(result.depths[i], expected.depths[i]);
+  }
+  if (!same && failures++ < 10) {
+    fprintf(stderr, "Mismatch: %s kernel, span of %d pixels at (%d, %d); "
+        "%d fragments, scalar kernel %d\n", cg::SpanKernelName(kernel), count,
+        x, y, static_cast<int>(result.fragments.size()),
+        static_cast<int>(expected.fragments.size()));
+  }
+  return same;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned int seed = 1;
+  if (argc > 1) {
+    seed = strtoul(argv[1], NULL, 10);
+  }
+  std::mt19937 random(seed);
+
+  const cg::SpanKernel kernels[] = { cg::kSse2Kernel, cg::kAvx2Kernel };
+  bool supported[2];
+  for (int k = 0; k < 2; k++) {
+    supported[k] = cg::SpanKernelSupported(kernels[k]);
+  }
+
+  int failures = 0;
+  int spans = 0;
+  int fragments = 0;
+  for (int kind = 0; kind < kNumTriangleKinds; kind++) {
+    std::vector<cg::TriangleSetup> triangles;
+    for (int i = 0; i < kTrianglesPerKind; i++) {
+      AddRandomTriangle(static_cast<TriangleKind>(kind), random, triangles);
+    }
+    if (triangles.empty()) {
+      fprintf(stderr, "Error: No %s triangles were set up.\n",
+          kTriangleKindNames[kind]);
+      return 1;
+    }
+
+    for (size_t i = 0; i < triangles.size(); i++) {
+      const cg::TriangleSetup& setup = triangles[i];
+      const int rows = setup.bottom - setup.top + 1;
+      for (int r = 0; r < std::min(rows, kMaxRowsPerTriangle); r++) {
+        const int y = (rows <= kMaxRowsPerTriangle) ? setup.top + r :
+            std::uniform_int_distribution<int>(setup.top,
+                setup.bottom)(random);
+
+        // Cover the row in spans of random lengths, so that the kernels'
+        // partial vectors are tested at every alignment.
+        int x = setup.left;
+        while (x <= setup.right) {
+          const int count = std::min(setup.right - x + 1,
+              std::uniform_int_distribution<int>(1,
+                  cg::kMaxSpanLength)(random));
+          std::vector<float> depths = RandomDepths(random, setup, count);
+          const SpanResult expected = RasterizeSpan(cg::kScalarKernel, setup,
+              x, y, count, depths);
+          for (int k = 0; k < 2; k++) {
+            if (!supported[k]) {
+              continue;
+            }
+            CheckSpan(kernels[k], expected, setup, x, y, count, depths,
+                failures);
+            // Rasterizing again over its own depths, every fragment ties.
+            CheckSpan(kernels[k], RasterizeSpan(cg::kScalarKernel, setup, x,
+                y, count, expected.depths), setup, x, y, count,
+                expected.depths, failures);
+          }
+          spans++;
+          fragments += expected.fragments.size();
+          x += count;
+        }
+      }
+    }
+    printf("Tested %d %s triangle setups\n",
+        static_cast<int>(triangles.size()), kTriangleKindNames[kind]);
+  }
+
+  printf("Compared %d spans (%d fragments) with the scalar kernel:", spans,
+      fragments);
+  for (int k = 0; k < 2; k++) {
+    printf(" %s %s", cg::SpanKernelName(kernels[k]),
+        supported[k] ? "tested" : "skipped (not supported)");
+    printf(k == 0 ? "," : "\n");
+  }
+  if (failures > 0) {
+    fprintf(stderr, "FAILED: %d spans differed\n", failures);
+    return 1;
+  }
+  printf("PASSED\n");
+  return 0;
+}
@@ -0,0 +1,44 @@
+//! \author Stephen McGruer
+
+#include "./mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace computer_graphics {
+
+MappedFile::~MappedFile() {
+  if (data_ != NULL) {
+    munmap(data_, size_);
+  }
+}
+
+bool MappedFile::Open(const char* filename) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+  size_ = info.st_size;
+
+  // mmap() refuses empty mappings, and there is nothing to map anyway.
+  if (size_ > 0) {
+    void* memory = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+        0);
+    if (memory == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+    data_ = static_cast<char*>(memory);
+  }
+  close(fd);
+  return true;
+}
+}  // namespace computer_graphics
@@ -0,0 +1,40 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_MAPPEDFILE_H_
+#define SRC_MAPPEDFILE_H_
+
+#include <cstddef>
+
+namespace computer_graphics {
+
+//! \class MappedFile
+//! \brief A private memory mapping of a whole file, unmapped on destruction.
+//!
+//! The mapping is copy-on-write: it may be modified in place, and the
+//! modified pages are copied rather than written back to the file.
+class MappedFile {
+  public:
+    MappedFile()
+        : data_(NULL),
+          size_(0) {
+    }
+
+    ~MappedFile();
+
+    //! Returns false if the file could not be opened or mapped.
+    bool Open(const char* filename);
+
+    inline char* data() const { return data_; }
+    inline size_t size() const { return size_; }
+
+  private:
+    // Mappings cannot be copied.
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    char* data_;
+    size_t size_;
+};
+}  // namespace computer_graphics
+
+#endif  // SRC_MAPPEDFILE_H_
@@ -0,0 +1,190 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_MAT4_H_
+#define SRC_MAT4_H_
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace computer_graphics {
+
+//! \class Vec4T
+//! \brief A four component vector, used as a homogeneous point or direction.
+//!
+//! Aligned so that it can be loaded into a single SIMD register.
+template <typename T>
+class alignas(16) Vec4T {
+  public:
+    constexpr Vec4T()
+        : v_{0, 0, 0, 0} {
+    }
+
+    constexpr Vec4T(T x, T y, T z, T w)
+        : v_{x, y, z, w} {
+    }
+
+    constexpr T operator[](int i) const { return v_[i]; }
+    inline T& operator[](int i) { return v_[i]; }
+
+    constexpr T x() const { return v_[0]; }
+    constexpr T y() const { return v_[1]; }
+    constexpr T z() const { return v_[2]; }
+    constexpr T w() const { return v_[3]; }
+
+    inline const T* data() const { return v_; }
+    inline T* data() { return v_; }
+
+  private:
+    T v_[4];
+};
+
+//! \class Mat4T
+//! \brief A 4x4 transformation matrix, held by value.
+//!
+//! Elements are accessed as m(row, column). They are stored column by column,
+//! so that multiplying a vector is a sum of four scaled columns, each of
+//! which fits in a SIMD register. Constructors take their arguments row by
+//! row, as the matrix would be written down.
+template <typename T>
+class alignas(16) Mat4T {
+  public:
+    //! Constructs the identity matrix.
+    constexpr Mat4T()
+        : m_{1, 0, 0, 0,
+             0, 1, 0, 0,
+             0, 0, 1, 0,
+             0, 0, 0, 1} {
+    }
+
+    constexpr Mat4T(T m00, T m01, T m02, T m03,
+                    T m10, T m11, T m12, T m13,
+                    T m20, T m21, T m22, T m23,
+                    T m30, T m31, T m32, T m33)
+        : m_{m00, m10, m20, m30,
+             m01, m11, m21, m31,
+             m02, m12, m22, m32,
+             m03, m13, m23, m33} {
+    }
+
+    static constexpr Mat4T Translation(T dx, T dy, T dz) {
+      return Mat4T(1, 0, 0, dx,
+                   0, 1, 0, dy,
+                   0, 0, 1, dz,
+                   0, 0, 0, 1);
+    }
+
+    static constexpr Mat4T Scale(T sx, T sy, T sz) {
+      return Mat4T(sx, 0, 0, 0,
+                   0, sy, 0, 0,
+                   0, 0, sz, 0,
+                   0, 0, 0, 1);
+    }
+
+    //! Shears x by dx times y.
+    static constexpr Mat4T XShear(T dx) {
+      return Mat4T(1, dx, 0, 0,
+                   0, 1, 0, 0,
+                   0, 0, 1, 0,
+                   0, 0, 0, 1);
+    }
+
+    //! Shears y by dy times x.
+    static constexpr Mat4T YShear(T dy) {
+      return Mat4T(1, 0, 0, 0,
+                   dy, 1, 0, 0,
+                   0, 0, 1, 0,
+                   0, 0, 0, 1);
+    }
+
+    //! \brief Rotations about the axes, given the cosine and sine of the
+    //!        angle.
+    //!
+    //! Taking the cosine and sine rather than the angle keeps these constant
+    //! expressions.
+    static constexpr Mat4T XRotation(T cos_theta, T sin_theta) {
+      return Mat4T(1, 0, 0, 0,
+                   0, cos_theta, -sin_theta, 0,
+                   0, sin_theta, cos_theta, 0,
+                   0, 0, 0, 1);
+    }
+
+    static constexpr Mat4T YRotation(T cos_theta, T sin_theta) {
+      return Mat4T(cos_theta, 0, sin_theta, 0,
+                   0, 1, 0, 0,
+                   -sin_theta, 0, cos_theta, 0,
+                   0, 0, 0, 1);
+    }
+
+    static constexpr Mat4T ZRotation(T cos_theta, T sin_theta) {
+      return Mat4T(cos_theta, -sin_theta, 0, 0,
+                   sin_theta, cos_theta, 0, 0,
+                   0, 0, 1, 0,
+                   0, 0, 0, 1);
+    }
+
+    constexpr T operator()(int row, int col) const {
+      return m_[col * 4 + row];
+    }
+    inline T& operator()(int row, int col) {
+      return m_[col * 4 + row];
+    }
+
+    //! Returns the four elements of a column, contiguous in memory.
+    inline const T* column(int col) const { return m_ + col * 4; }
+
+  private:
+    T m_[16];
+};
+
+//! \brief Transforms a vector.
+//!
+//! Each element is summed in column order, so results match a plain
+//! row-by-column product exactly.
+template <typename T>
+inline Vec4T<T> operator*(const Mat4T<T>& m, const Vec4T<T>& v) {
+  Vec4T<T> result;
+  for (int row = 0; row < 4; row++) {
+    result[row] = m(row, 0) * v[0] + m(row, 1) * v[1] + m(row, 2) * v[2] +
+        m(row, 3) * v[3];
+  }
+  return result;
+}
+
+#if defined(__SSE__)
+//! The same as the generic version, four rows at a time.
+template <>
+inline Vec4T<float> operator*(const Mat4T<float>& m, const Vec4T<float>& v) {
+  __m128 sum = _mm_mul_ps(_mm_load_ps(m.column(0)), _mm_set1_ps(v[0]));
+  sum = _mm_add_ps(sum,
+      _mm_mul_ps(_mm_load_ps(m.column(1)), _mm_set1_ps(v[1])));
+  sum = _mm_add_ps(sum,
+      _mm_mul_ps(_mm_load_ps(m.column(2)), _mm_set1_ps(v[2])));
+  sum = _mm_add_ps(sum,
+      _mm_mul_ps(_mm_load_ps(m.column(3)), _mm_set1_ps(v[3])));
+
+  Vec4T<float> result;
+  _mm_store_ps(result.data(), sum);
+  return result;
+}
+#endif
+
+//! Composes two transformations; the result applies b, then a.
+template <typename T>
+inline Mat4T<T> operator*(const Mat4T<T>& a, const Mat4T<T>& b) {
+  Mat4T<T> result;
+  for (int col = 0; col < 4; col++) {
+    Vec4T<T> product = a * Vec4T<T>(b(0, col), b(1, col), b(2, col),
+        b(3, col));
+    for (int row = 0; row < 4; row++) {
+      result(row, col) = product[row];
+    }
+  }
+  return result;
+}
+
+typedef Vec4T<float> Vec4;
+typedef Mat4T<float> Mat4;
+}  // namespace computer_graphics
+
+#endif  // SRC_MAT4_H_
@@ -0,0 +1,315 @@
+//! \author Stephen McGruer
+
+#include "./mesh_cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "./mapped_file.h"
+
+namespace computer_graphics {
+
+namespace {
+//! Identifies cache files. The version must change whenever the layout, or
+//! the way the mesh is prepared, does.
+const char kMagic[8] = { 'C', 'G', 'M', 'E', 'S', 'H', '\0', '\0' };
+const uint32_t kVersion = 3;
+
+//! Written as a native integer, so that caches from machines of the other
+//! byte order are rejected.
+const uint32_t kByteOrderMark = 0x01020304;
+
+//! Sections start on cache line boundaries, which keeps every array as
+//! aligned as an owned one would be.
+const uint64_t kSectionAlignment = 64;
+
+enum Flags {
+  kNormalised = 1 << 0,
+  kSuppliedNormals = 1 << 1
+};
+
+//! The arrays in a cache file, in the order they are written.
+enum Section {
+  kPositionsX,
+  kPositionsY,
+  kPositionsZ,
+  kTriangles,
+  kVertexNormalsX,
+  kVertexNormalsY,
+  kVertexNormalsZ,
+  kTriangleNormalsX,
+  kTriangleNormalsY,
+  kTriangleNormalsZ,
+  kTexcoordsX,
+  kTexcoordsY,
+  kTexcoordsZ,
+  kAdjacencyOffsets,
+  kAdjacency,
+  kNumSections
+};
+
+// Triangles are written and viewed as three ints each.
+static_assert(sizeof(Triangle) == 3 * sizeof(int),
+    "Triangle must be three packed ints");
+
+//! The start of a cache file.
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t flags;
+
+    int32_t num_vertices;
+    int32_t num_triangles;
+    int32_t num_texcoords;
+
+    //! The mesh file that the cache was built from. Its modification time
+    //! is kept to the nanosecond, as a file rewritten within a second of
+    //! the cache would otherwise still match it.
+    uint64_t mesh_size;
+    int64_t mesh_modified;
+    int64_t mesh_modified_nsec;
+
+    float centre[3];
+    float min[3];
+    float max[3];
+
+    //! Where each section starts, and its length, in bytes.
+    uint64_t offsets[kNumSections];
+    uint64_t sizes[kNumSections];
+};
+
+//! Reads the size and modification time of a file.
+bool Stat(const char* filename, uint64_t& size, int64_t& modified,
+    int64_t& modified_nsec) {
+  struct stat info;
+  if (stat(filename, &info) != 0) {
+    return false;
+  }
+  size = info.st_size;
+  modified = info.st_mtim.tv_sec;
+  modified_nsec = info.st_mtim.tv_nsec;
+  return true;
+}
+
+//! Returns the expected length of each section, in bytes.
+void SectionSizes(const Header& header, uint64_t sizes[kNumSections]) {
+  const uint64_t vertices = header.num_vertices;
+  const uint64_t triangles = header.num_triangles;
+  for (int axis = 0; axis < 3; axis++) {
+    sizes[kPositionsX + axis] = vertices * sizeof(float);
+    sizes[kVertexNormalsX + axis] = vertices * sizeof(float);
+    sizes[kTriangleNormalsX + axis] = triangles * sizeof(float);
+    sizes[kTexcoordsX + axis] = header.num_texcoords * sizeof(float);
+  }
+  sizes[kTriangles] = triangles * sizeof(Triangle);
+  sizes[kAdjacencyOffsets] = (vertices + 1) * sizeof(int);
+  sizes[kAdjacency] = 3 * triangles * sizeof(int);
+}
+
+//! \brief Returns true if every index in a cache's triangles and adjacency
+//!        refers to a vertex or triangle that it has.
+//!
+//! A corrupt cache must not get as far as the renderer, which trusts the
+//! indices. The offsets must also run in order from 0 to the length of the
+//! adjacency, so that every vertex's triangles lie within it.
+bool IndicesValid(const Header& header, const char* data) {
+  const int64_t num_vertices = header.num_vertices;
+  const int64_t num_triangles = header.num_triangles;
+
+  const int* triangles = reinterpret_cast<const int*>(
+      data + header.offsets[kTriangles]);
+  for (int64_t i = 0; i < 3 * num_triangles; i++) {
+    if (triangles[i] < 0 || triangles[i] >= num_vertices) {
+      return false;
+    }
+  }
+
+  const int* offsets = reinterpret_cast<const int*>(
+      data + header.offsets[kAdjacencyOffsets]);
+  if (offsets[0] != 0 || offsets[num_vertices] != 3 * num_triangles) {
+    return false;
+  }
+  for (int64_t i = 0; i < num_vertices; i++) {
+    if (offsets[i] > offsets[i + 1]) {
+      return false;
+    }
+  }
+
+  const int* adjacency = reinterpret_cast<const int*>(
+      data + header.offsets[kAdjacency]);
+  for (int64_t i = 0; i < 3 * num_triangles; i++) {
+    if (adjacency[i] < 0 || adjacency[i] >= num_triangles) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! Copies a Vertex into a float array.
+void Store(const Vertex& vertex, float out[3]) {
+  out[0] = vertex[0];
+  out[1] = vertex[1];
+  out[2] = vertex[2];
+}
+
+//! Writes a VertexStream's components to the sections starting at first.
+void SetSections(const VertexStream& stream, Section first,
+    const void* data[kNumSections]) {
+  data[first] = stream.x().data();
+  data[first + 1] = stream.y().data();
+  data[first + 2] = stream.z().data();
+}
+}  // namespace
+
+void MeshCacheFilename(const char* mesh_filename, char* cache_filename,
+    int size) {
+  snprintf(cache_filename, size, "%s.cache", mesh_filename);
+}
+
+bool ReadMeshCache(const char* cache_filename, const char* mesh_filename,
+    bool normalised, MeshCache& cache) {
+  uint64_t mesh_size;
+  int64_t mesh_modified;
+  int64_t mesh_modified_nsec;
+  if (!Stat(mesh_filename, mesh_size, mesh_modified, mesh_modified_nsec)) {
+    return false;
+  }
+
+  std::shared_ptr<MappedFile> file(new MappedFile());
+  if (!file->Open(cache_filename) || file->size() < sizeof(Header)) {
+    return false;
+  }
+
+  Header header;
+  memcpy(&header, file->data(), sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion ||
+      header.byte_order_mark != kByteOrderMark ||
+      ((header.flags & kNormalised) != 0) != normalised ||
+      header.mesh_size != mesh_size ||
+      header.mesh_modified != mesh_modified ||
+      header.mesh_modified_nsec != mesh_modified_nsec ||
+      header.num_vertices < 0 || header.num_triangles < 0 ||
+      (header.num_texcoords != 0 &&
+       header.num_texcoords != header.num_vertices)) {
+    return false;
+  }
+
+  uint64_t sizes[kNumSections];
+  SectionSizes(header, sizes);
+  for (int i = 0; i < kNumSections; i++) {
+    if (header.sizes[i] != sizes[i] ||
+        header.offsets[i] % kSectionAlignment != 0 ||
+        header.offsets[i] > file->size() ||
+        sizes[i] > file->size() - header.offsets[i]) {
+      return false;
+    }
+  }
+
+  char* data = file->data();
+  if (!IndicesValid(header, data)) {
+    return false;
+  }
+
+  float* floats[kNumSections];
+  for (int i = 0; i < kNumSections; i++) {
+    floats[i] = reinterpret_cast<float*>(data + header.offsets[i]);
+  }
+
+  cache.positions = VertexStream::View(floats[kPositionsX],
+      floats[kPositionsY], floats[kPositionsZ], header.num_vertices, file);
+  cache.triangles = Buffer<Triangle>::View(
+      reinterpret_cast<Triangle*>(data + header.offsets[kTriangles]),
+      header.num_triangles, file);
+  cache.vertex_normals = VertexStream::View(floats[kVertexNormalsX],
+      floats[kVertexNormalsY], floats[kVertexNormalsZ], header.num_vertices,
+      file);
+  cache.triangle_normals = VertexStream::View(floats[kTriangleNormalsX],
+      floats[kTriangleNormalsY], floats[kTriangleNormalsZ],
+      header.num_triangles, file);
+  cache.supplied_normals = (header.flags & kSuppliedNormals) != 0;
+  cache.texcoords = VertexStream::View(floats[kTexcoordsX],
+      floats[kTexcoordsY], floats[kTexcoordsZ], header.num_texcoords, file);
+  cache.adjacency_offsets = Buffer<int>::View(
+      reinterpret_cast<int*>(data + header.offsets[kAdjacencyOffsets]),
+      header.num_vertices + 1, file);
+  cache.adjacency = Buffer<int>::View(
+      reinterpret_cast<int*>(data + header.offsets[kAdjacency]),
+      3 * header.num_triangles, file);
+  cache.centre = Vertex(header.centre[0], header.centre[1], header.centre[2]);
+  cache.min = Vertex(header.min[0], header.min[1], header.min[2]);
+  cache.max = Vertex(header.max[0], header.max[1], header.max[2]);
+  return true;
+}
+
+bool WriteMeshCache(const char* cache_filename, const char* mesh_filename,
+    bool normalised, const MeshCache& cache) {
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.flags = (normalised ? kNormalised : 0) |
+      (cache.supplied_normals ? kSuppliedNormals : 0);
+  header.num_vertices = cache.positions.size();
+  header.num_triangles = cache.triangles.size();
+  header.num_texcoords = cache.texcoords.size();
+  if (!Stat(mesh_filename, header.mesh_size, header.mesh_modified,
+      header.mesh_modified_nsec)) {
+    return false;
+  }
+  Store(cache.centre, header.centre);
+  Store(cache.min, header.min);
+  Store(cache.max, header.max);
+
+  const void* data[kNumSections];
+  SetSections(cache.positions, kPositionsX, data);
+  SetSections(cache.vertex_normals, kVertexNormalsX, data);
+  SetSections(cache.triangle_normals, kTriangleNormalsX, data);
+  SetSections(cache.texcoords, kTexcoordsX, data);
+  data[kTriangles] = cache.triangles.data();
+  data[kAdjacencyOffsets] = cache.adjacency_offsets.data();
+  data[kAdjacency] = cache.adjacency.data();
+
+  SectionSizes(header, header.sizes);
+  uint64_t offset = sizeof(header);
+  for (int i = 0; i < kNumSections; i++) {
+    offset = (offset + kSectionAlignment - 1) / kSectionAlignment *
+        kSectionAlignment;
+    header.offsets[i] = offset;
+    offset += header.sizes[i];
+  }
+
+  // Readers only ever see a complete file.
+  char temporary_filename[1024];
+  snprintf(temporary_filename, sizeof(temporary_filename), "%s.%d.tmp",
+      cache_filename, static_cast<int>(getpid()));
+  FILE* f = fopen(temporary_filename, "wb");
+  if (f == NULL) {
+    return false;
+  }
+
+  static const char kPadding[kSectionAlignment] = { 0 };
+  bool written = fwrite(&header, sizeof(header), 1, f) == 1;
+  uint64_t position = sizeof(header);
+  for (int i = 0; i < kNumSections && written; i++) {
+    written = fwrite(kPadding, 1, header.offsets[i] - position, f) ==
+        header.offsets[i] - position &&
+        fwrite(data[i], 1, header.sizes[i], f) == header.sizes[i];
+    position = header.offsets[i] + header.sizes[i];
+  }
+  written = (fclose(f) == 0) && written;
+
+  if (!written || rename(temporary_filename, cache_filename) != 0) {
+    unlink(temporary_filename);
+    return false;
+  }
+  return true;
+}
+}  // namespace computer_graphics
@@ -0,0 +1,76 @@
+//! \author Stephen McGruer
+
+// Reads and writes binary mesh cache files.
+
+#ifndef SRC_MESHCACHE_H_
+#define SRC_MESHCACHE_H_
+
+#include "./buffer.h"
+#include "./triangle.h"
+#include "./vertex.h"
+#include "./vertex_stream.h"
+
+namespace computer_graphics {
+
+//! \struct MeshCache
+//! \brief Everything TriangleMesh needs from a mesh file, in the form it
+//!        keeps it in memory.
+//!
+//! All of it is in object space, with the triangles and vertices in the
+//! order that TriangleMesh draws them. When read from a cache file, every array
+//! views the mapped file.
+struct MeshCache {
+    VertexStream positions;
+    Buffer<Triangle> triangles;
+
+    //! The normals of each vertex and triangle. The vertex normals are the
+    //! ones the mesh file gave, if supplied_normals is set.
+    VertexStream vertex_normals;
+    VertexStream triangle_normals;
+    bool supplied_normals;
+
+    //! The texture coordinates of each vertex; may be empty.
+    VertexStream texcoords;
+
+    //! The triangles that each vertex belongs to, in compressed sparse row
+    //! form: those of vertex v are adjacency[adjacency_offsets[v]] up to
+    //! adjacency[adjacency_offsets[v + 1]].
+    Buffer<int> adjacency_offsets;
+    Buffer<int> adjacency;
+
+    //! The mean of the positions, and their bounding box.
+    Vertex centre;
+    Vertex min;
+    Vertex max;
+
+    MeshCache()
+        : supplied_normals(false) {
+    }
+};
+
+//! \brief Returns the name of the cache file for a mesh file.
+//!
+//! The cache sits next to the mesh file, with ".cache" appended.
+void MeshCacheFilename(const char* mesh_filename, char* cache_filename,
+    int size);
+
+//! \brief Memory-maps a cache file into cache.
+//!
+//! Returns false, leaving cache untouched, if there is no cache, if it was
+//! written by a different version of the format, or if it does not match
+//! the current mesh file (by size and modification time, to the
+//! nanosecond) or the normalise option it was built with. So does a cache
+//! whose triangles or adjacency hold an index out of range.
+bool ReadMeshCache(const char* cache_filename, const char* mesh_filename,
+    bool normalised, MeshCache& cache);
+
+//! \brief Writes cache to a cache file for the given mesh file.
+//!
+//! The file is written under a temporary name and renamed into place, so
+//! that concurrent readers never see a partial cache. Returns false if it
+//! could not be written.
+bool WriteMeshCache(const char* cache_filename, const char* mesh_filename,
+    bool normalised, const MeshCache& cache);
+}  // namespace computer_graphics
+
+#endif  // SRC_MESHCACHE_H_
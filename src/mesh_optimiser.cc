@@ -0,0 +1,239 @@
+//! \author Stephen McGruer
+
+#include "./mesh_optimiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "./job_system.h"
+
+namespace computer_graphics {
+
+namespace {
+//! The scoring parameters from Forsyth's article.
+const float kCacheDecayPower = 1.5f;
+const float kLastTriangleScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+
+//! Valence boosts are looked up for vertices with up to this many triangles
+//! left, and computed for the rest.
+const int kMaxTabulatedValence = 64;
+
+//! \brief Scores a vertex by its position in the cache (-1 if it is not in
+//!        it) and the number of its triangles that are left to draw.
+//!
+//! Vertices that were used recently score highly, as their triangles would
+//! reuse them, and so do vertices with few triangles left, so that they are
+//! finished off rather than left as isolated triangles for later.
+class VertexScorer {
+  public:
+    VertexScorer() {
+      for (int i = 0; i < kVertexCacheSize; i++) {
+        if (i < 3) {
+          // The last triangle's vertices get a fixed score, so that the
+          // next triangle does not prefer to reuse two of them over one.
+          position_scores_[i] = kLastTriangleScore;
+        } else {
+          const float scale = 1.0f / (kVertexCacheSize - 3);
+          position_scores_[i] =
+              std::pow(1.0f - (i - 3) * scale, kCacheDecayPower);
+        }
+      }
+      for (int i = 1; i <= kMaxTabulatedValence; i++) {
+        valence_scores_[i] = ValenceScore(i);
+      }
+    }
+
+    inline float Score(int cache_position, int remaining) const {
+      if (remaining == 0) {
+        return -1.0f;
+      }
+      float score = (cache_position >= 0) ?
+          position_scores_[cache_position] : 0.0f;
+      return score + ((remaining <= kMaxTabulatedValence) ?
+          valence_scores_[remaining] : ValenceScore(remaining));
+    }
+
+  private:
+    static inline float ValenceScore(int remaining) {
+      return kValenceBoostScale *
+          std::pow(static_cast<float>(remaining), -kValenceBoostPower);
+    }
+
+    float position_scores_[kVertexCacheSize];
+    float valence_scores_[kMaxTabulatedValence + 1];
+};
+}  // namespace
+
+float AverageCacheMissRatio(const std::vector<int>& triangles) {
+  if (triangles.empty()) {
+    return 0.0f;
+  }
+
+  // A vertex is still cached if fewer than kVertexCacheSize misses have
+  // happened since it was fetched.
+  const int num_vertices =
+      *std::max_element(triangles.begin(), triangles.end()) + 1;
+  std::vector<int> fetched(num_vertices, -kVertexCacheSize - 1);
+  int misses = 0;
+  for (size_t i = 0; i < triangles.size(); i++) {
+    if (misses - fetched[triangles[i]] > kVertexCacheSize) {
+      fetched[triangles[i]] = misses;
+      misses++;
+    }
+  }
+  return static_cast<float>(misses) / (triangles.size() / 3);
+}
+
+void OptimiseTriangleOrder(int num_vertices, std::vector<int>& triangles) {
+  const int num_triangles = triangles.size() / 3;
+  if (num_triangles == 0) {
+    return;
+  }
+
+  // The triangles of each vertex, in compressed sparse row form. The first
+  // remaining[v] of vertex v's triangles are the ones still to be drawn.
+  std::vector<int> offsets(num_vertices + 1, 0);
+  for (size_t i = 0; i < triangles.size(); i++) {
+    offsets[triangles[i] + 1]++;
+  }
+  for (int i = 0; i < num_vertices; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  std::vector<int> vertex_triangles(triangles.size());
+  std::vector<int> remaining(num_vertices, 0);
+  for (size_t i = 0; i < triangles.size(); i++) {
+    const int vertex = triangles[i];
+    vertex_triangles[offsets[vertex] + remaining[vertex]++] = i / 3;
+  }
+
+  const VertexScorer scorer;
+  std::vector<float> scores(num_vertices);
+  for (int i = 0; i < num_vertices; i++) {
+    scores[i] = scorer.Score(-1, remaining[i]);
+  }
+
+  // The simulated cache, most recently used first. It has room for the
+  // vertices of one more triangle, which push the oldest ones out.
+  int cache[kVertexCacheSize + 3];
+  int cache_size = 0;
+
+  std::vector<char> drawn(num_triangles, false);
+  std::vector<int> ordered;
+  ordered.reserve(triangles.size());
+  int best = -1;
+  int next_undrawn = 0;
+  for (int n = 0; n < num_triangles; n++) {
+    if (best < 0) {
+      // None of the cached vertices have triangles left, so carry on from
+      // the first triangle that has not been drawn.
+      while (drawn[next_undrawn]) {
+        next_undrawn++;
+      }
+      best = next_undrawn;
+    }
+
+    const int* vertices = &triangles[3 * best];
+    ordered.insert(ordered.end(), vertices, vertices + 3);
+    drawn[best] = true;
+
+    for (int j = 0; j < 3; j++) {
+      int* begin = &vertex_triangles[offsets[vertices[j]]];
+      int* end = begin + remaining[vertices[j]];
+      std::swap(*std::find(begin, end, best), *(end - 1));
+      remaining[vertices[j]]--;
+    }
+
+    // Move the triangle's vertices to the front of the cache.
+    int new_cache[kVertexCacheSize + 3];
+    int new_cache_size = 0;
+    for (int j = 0; j < 3; j++) {
+      new_cache[new_cache_size++] = vertices[j];
+    }
+    for (int i = 0; i < cache_size; i++) {
+      if (cache[i] != vertices[0] && cache[i] != vertices[1] &&
+          cache[i] != vertices[2]) {
+        new_cache[new_cache_size++] = cache[i];
+      }
+    }
+
+    // Rescore the cached vertices, and any that just fell out, then pick
+    // the best of their triangles to draw next.
+    for (int i = 0; i < new_cache_size; i++) {
+      const int vertex = new_cache[i];
+      scores[vertex] = scorer.Score((i < kVertexCacheSize) ? i : -1,
+          remaining[vertex]);
+    }
+
+    best = -1;
+    float best_score = -1.0f;
+    for (int i = 0; i < new_cache_size; i++) {
+      const int vertex = new_cache[i];
+      for (int k = offsets[vertex]; k < offsets[vertex] + remaining[vertex];
+          k++) {
+        const int triangle = vertex_triangles[k];
+        const int* corners = &triangles[3 * triangle];
+        const float score =
+            scores[corners[0]] + scores[corners[1]] + scores[corners[2]];
+        if (score > best_score) {
+          best = triangle;
+          best_score = score;
+        }
+      }
+    }
+
+    cache_size = std::min(new_cache_size, kVertexCacheSize);
+    std::copy(new_cache, new_cache + cache_size, cache);
+  }
+
+  // Meshes made of strips or patches can already beat the heuristic, so
+  // those keep their order.
+  if (AverageCacheMissRatio(ordered) < AverageCacheMissRatio(triangles)) {
+    triangles.swap(ordered);
+  }
+}
+
+void OptimiseVertexOrder(ObjData& data) {
+  const int num_vertices = data.positions.size();
+  std::vector<int> new_indices(num_vertices, -1);
+  std::vector<int> old_indices;
+  old_indices.reserve(num_vertices);
+  for (size_t i = 0; i < data.triangles.size(); i++) {
+    if (new_indices[data.triangles[i]] < 0) {
+      new_indices[data.triangles[i]] = old_indices.size();
+      old_indices.push_back(data.triangles[i]);
+    }
+  }
+  for (int i = 0; i < num_vertices; i++) {
+    if (new_indices[i] < 0) {
+      new_indices[i] = old_indices.size();
+      old_indices.push_back(i);
+    }
+  }
+
+  VertexStream* streams[] = {
+    &data.positions, &data.texcoords, &data.normals
+  };
+  for (int i = 0; i < 3; i++) {
+    if (streams[i]->size() == 0) {
+      continue;
+    }
+    VertexStream reordered;
+    reordered.resize(num_vertices);
+    Jobs().ParallelForBlocks(num_vertices, kStreamBlockSize,
+        [&](int begin, int end) {
+      GatherVertices(*streams[i], old_indices.data(), begin, end, reordered);
+    });
+    *streams[i] = std::move(reordered);
+  }
+
+  Jobs().ParallelForBlocks(data.triangles.size(), kStreamBlockSize,
+      [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      data.triangles[i] = new_indices[data.triangles[i]];
+    }
+  });
+}
+}  // namespace computer_graphics
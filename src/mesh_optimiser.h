@@ -0,0 +1,47 @@
+//! \author Stephen McGruer
+
+// Reorders meshes so that the vertices they use are close together, in the
+// order they are drawn and in memory.
+
+#ifndef SRC_MESHOPTIMISER_H_
+#define SRC_MESHOPTIMISER_H_
+
+#include <vector>
+
+#include "./obj_loader.h"
+
+namespace computer_graphics {
+
+//! The number of recently used vertices that OptimiseTriangleOrder() aims to
+//! keep each triangle's vertices within, and that AverageCacheMissRatio()
+//! simulates.
+const int kVertexCacheSize = 32;
+
+//! \brief Returns the average cache miss ratio (ACMR) of a triangle list:
+//!        the number of vertices fetched per triangle through a first-in
+//!        first-out cache of kVertexCacheSize vertices.
+//!
+//! This lies between about 0.5, when every vertex is fetched once, and 3,
+//! when no vertex is reused while it is still in the cache.
+float AverageCacheMissRatio(const std::vector<int>& triangles);
+
+//! \brief Reorders the triangles so that each one shares as many vertices as
+//!        possible with those drawn just before it.
+//!
+//! This is Tom Forsyth's linear-speed vertex cache optimisation. Each vertex
+//! is scored by how recently it was used and by how few triangles it has
+//! left, and the next triangle is the highest-scoring one among those of
+//! the recently used vertices. The vertices themselves are not moved. If
+//! the new order has a higher AverageCacheMissRatio() than the current one,
+//! the current one is kept.
+void OptimiseTriangleOrder(int num_vertices, std::vector<int>& triangles);
+
+//! \brief Renumbers the vertices in the order that the triangles first use
+//!        them, so that vertex fetches walk through memory in order.
+//!
+//! Vertices that no triangle uses are moved to the end, in their current
+//! order.
+void OptimiseVertexOrder(ObjData& data);
+}  // namespace computer_graphics
+
+#endif  // SRC_MESHOPTIMISER_H_
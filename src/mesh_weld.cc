@@ -0,0 +1,331 @@
+//! \author Stephen McGruer
+
+#include "./mesh_weld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "./job_system.h"
+
+namespace computer_graphics {
+
+namespace {
+//! Cell coordinates are clamped to this, so that vertices far from the
+//! origin, or a tiny epsilon, cannot overflow them.
+const double kMaxCell = 1e15;
+
+//! The cell of the hash grid that a vertex falls in.
+struct Cell {
+    int64_t x;
+    int64_t y;
+    int64_t z;
+};
+
+//! \brief Returns the cell coordinate of a vertex component.
+//!
+//! With an epsilon of zero, only identical values share a cell, so the
+//! value's bits are used directly. Adding zero first turns -0 into +0, as
+//! the two compare equal.
+inline int64_t CellCoordinate(float value, float epsilon) {
+  if (epsilon == 0.0f) {
+    const float positive_zero = value + 0.0f;
+    int32_t bits;
+    memcpy(&bits, &positive_zero, sizeof(bits));
+    return bits;
+  }
+  double cell = std::floor(value / static_cast<double>(epsilon));
+  return static_cast<int64_t>(std::max(-kMaxCell, std::min(kMaxCell, cell)));
+}
+
+//! Returns the hash table bucket of a cell, out of 2^bits buckets.
+inline uint32_t Bucket(int64_t x, int64_t y, int64_t z, int bits) {
+  uint64_t hash = static_cast<uint64_t>(x) * 73856093u ^
+      static_cast<uint64_t>(y) * 19349663u ^
+      static_cast<uint64_t>(z) * 83492791u;
+  return (hash * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+//! Returns true if elements i and j of a stream are within epsilon of each
+//! other. An empty stream always matches.
+inline bool Within(const VertexStream& stream, int i, int j,
+    float epsilon_squared) {
+  if (stream.size() == 0) {
+    return true;
+  }
+  const float dx = stream.x()[i] - stream.x()[j];
+  const float dy = stream.y()[i] - stream.y()[j];
+  const float dz = stream.z()[i] - stream.z()[j];
+  return dx * dx + dy * dy + dz * dz <= epsilon_squared;
+}
+
+//! Returns a stream of the elements of in at the given indices.
+VertexStream Gather(const VertexStream& in, const std::vector<int>& indices) {
+  VertexStream out;
+  if (in.size() == 0) {
+    return out;
+  }
+  out.resize(indices.size());
+  Jobs().ParallelForBlocks(indices.size(), kStreamBlockSize,
+      [&](int begin, int end) {
+    GatherVertices(in, indices.data(), begin, end, out);
+  });
+  return out;
+}
+
+//! Appends printf-style formatted text to a buffer.
+void Append(std::vector<char>& text, const char* format, ...) {
+  char line[256];
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(line, sizeof(line), format, arguments);
+  va_end(arguments);
+  text.insert(text.end(), line,
+      line + std::min<int>(length, sizeof(line) - 1));
+}
+
+//! \brief Writes count lines to f, where format appends the text of line i
+//!        to a buffer.
+//!
+//! Blocks of lines are formatted in parallel and written in order, a batch
+//! of blocks at a time so that the whole file is never held in memory.
+bool WriteLines(FILE* f, int count,
+    const std::function<void(int, std::vector<char>&)>& format) {
+  const int batch_size = 4 * Jobs().num_threads() * kStreamBlockSize;
+  std::vector<std::vector<char> > blocks;
+  for (int first = 0; first < count; first += batch_size) {
+    const int batch = std::min(batch_size, count - first);
+    blocks.assign((batch + kStreamBlockSize - 1) / kStreamBlockSize,
+        std::vector<char>());
+    Jobs().ParallelForBlocks(batch, kStreamBlockSize,
+        [&](int begin, int end) {
+      std::vector<char>& text = blocks[begin / kStreamBlockSize];
+      for (int i = begin; i < end; i++) {
+        format(first + i, text);
+      }
+    });
+    for (size_t i = 0; i < blocks.size(); i++) {
+      if (fwrite(blocks[i].data(), 1, blocks[i].size(), f) !=
+          blocks[i].size()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//! Writes every element of a stream as an OBJ record of the given type.
+bool WriteElements(FILE* f, const char* type, const VertexStream& stream) {
+  return WriteLines(f, stream.size(), [&](int i, std::vector<char>& text) {
+    Append(text, "%s %.9g %.9g %.9g\n", type, stream.x()[i], stream.y()[i],
+        stream.z()[i]);
+  });
+}
+}  // namespace
+
+int WeldVertices(float epsilon, ObjData& data) {
+  const int num_vertices = data.positions.size();
+  if (num_vertices == 0) {
+    return 0;
+  }
+
+  // Give the table at least twice as many buckets as there are vertices.
+  int bits = 1;
+  while ((static_cast<int64_t>(1) << bits) < 2 * num_vertices) {
+    bits++;
+  }
+
+  std::vector<Cell> cells(num_vertices);
+  std::vector<uint32_t> buckets(num_vertices);
+  Jobs().ParallelForBlocks(num_vertices, kStreamBlockSize,
+      [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      Vertex position = data.positions.Get(i);
+      Cell& cell = cells[i];
+      cell.x = CellCoordinate(position[0], epsilon);
+      cell.y = CellCoordinate(position[1], epsilon);
+      cell.z = CellCoordinate(position[2], epsilon);
+      buckets[i] = Bucket(cell.x, cell.y, cell.z, bits);
+    }
+  });
+
+  // Sort the vertices by bucket, keeping them in file order within each.
+  std::vector<int> bucket_offsets((static_cast<size_t>(1) << bits) + 1, 0);
+  for (int i = 0; i < num_vertices; i++) {
+    bucket_offsets[buckets[i] + 1]++;
+  }
+  for (size_t i = 1; i < bucket_offsets.size(); i++) {
+    bucket_offsets[i] += bucket_offsets[i - 1];
+  }
+  std::vector<int> bucket_vertices(num_vertices);
+  std::vector<int> next(bucket_offsets.begin(), bucket_offsets.end() - 1);
+  for (int i = 0; i < num_vertices; i++) {
+    bucket_vertices[next[buckets[i]]++] = i;
+  }
+
+  // Find the first vertex within epsilon of each vertex. Anything within
+  // epsilon is at most one cell away on each axis.
+  const float epsilon_squared = epsilon * epsilon;
+  const int reach = (epsilon > 0.0f) ? 1 : 0;
+  std::vector<int> remap(num_vertices);
+  Jobs().ParallelForBlocks(num_vertices, kStreamBlockSize,
+      [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      int match = i;
+      for (int dx = -reach; dx <= reach; dx++) {
+        for (int dy = -reach; dy <= reach; dy++) {
+          for (int dz = -reach; dz <= reach; dz++) {
+            const uint32_t bucket = Bucket(cells[i].x + dx, cells[i].y + dy,
+                cells[i].z + dz, bits);
+            for (int k = bucket_offsets[bucket];
+                k < bucket_offsets[bucket + 1]; k++) {
+              const int j = bucket_vertices[k];
+              if (j >= match) {
+                break;
+              }
+              if (Within(data.positions, i, j, epsilon_squared) &&
+                  Within(data.texcoords, i, j, epsilon_squared) &&
+                  Within(data.normals, i, j, epsilon_squared)) {
+                match = j;
+                break;
+              }
+            }
+          }
+        }
+      }
+      remap[i] = match;
+    }
+  });
+
+  // Each vertex maps to an earlier one, whose own mapping is already final.
+  int welded = 0;
+  for (int i = 0; i < num_vertices; i++) {
+    remap[i] = remap[remap[i]];
+    if (remap[i] != i) {
+      welded++;
+    }
+  }
+
+  Jobs().ParallelForBlocks(data.triangles.size(), kStreamBlockSize,
+      [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      data.triangles[i] = remap[data.triangles[i]];
+    }
+  });
+  return welded;
+}
+
+int RemoveDegenerateTriangles(ObjData& data) {
+  const int num_triangles = data.triangles.size() / 3;
+  std::vector<char> keep(num_triangles);
+  Jobs().ParallelForBlocks(num_triangles, kStreamBlockSize,
+      [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      const int* vertices = &data.triangles[3 * i];
+      if (vertices[0] == vertices[1] || vertices[1] == vertices[2] ||
+          vertices[2] == vertices[0]) {
+        keep[i] = false;
+        continue;
+      }
+
+      Vertex p1 = data.positions.Get(vertices[0]);
+      Vertex p2 = data.positions.Get(vertices[1]);
+      Vertex p3 = data.positions.Get(vertices[2]);
+      const float ax = p2[0] - p1[0];
+      const float ay = p2[1] - p1[1];
+      const float az = p2[2] - p1[2];
+      const float bx = p3[0] - p1[0];
+      const float by = p3[1] - p1[1];
+      const float bz = p3[2] - p1[2];
+      keep[i] = (ay * bz - az * by) != 0.0f || (az * bx - ax * bz) != 0.0f ||
+          (ax * by - ay * bx) != 0.0f;
+    }
+  });
+
+  int kept = 0;
+  for (int i = 0; i < num_triangles; i++) {
+    if (keep[i]) {
+      std::copy(&data.triangles[3 * i], &data.triangles[3 * i] + 3,
+          &data.triangles[3 * kept]);
+      kept++;
+    }
+  }
+  data.triangles.resize(3 * kept);
+  return num_triangles - kept;
+}
+
+int CompactVertices(ObjData& data) {
+  const int num_vertices = data.positions.size();
+  std::vector<int> new_indices(num_vertices, -1);
+  for (size_t i = 0; i < data.triangles.size(); i++) {
+    new_indices[data.triangles[i]] = 0;
+  }
+
+  std::vector<int> old_indices;
+  for (int i = 0; i < num_vertices; i++) {
+    if (new_indices[i] == 0) {
+      new_indices[i] = old_indices.size();
+      old_indices.push_back(i);
+    }
+  }
+  const int kept = old_indices.size();
+  if (kept == num_vertices) {
+    return 0;
+  }
+
+  data.positions = Gather(data.positions, old_indices);
+  data.texcoords = Gather(data.texcoords, old_indices);
+  data.normals = Gather(data.normals, old_indices);
+  Jobs().ParallelForBlocks(data.triangles.size(), kStreamBlockSize,
+      [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      data.triangles[i] = new_indices[data.triangles[i]];
+    }
+  });
+  return num_vertices - kept;
+}
+
+bool WriteObj(const char* filename, const ObjData& data) {
+  FILE* f = fopen(filename, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed writing %s\n", filename);
+    return false;
+  }
+
+  // Every vertex has at most one texture coordinate and normal, with the
+  // same index as the vertex.
+  const char* corner;
+  if (data.texcoords.size() > 0 && data.normals.size() > 0) {
+    corner = " %1$d/%1$d/%1$d";
+  } else if (data.texcoords.size() > 0) {
+    corner = " %1$d/%1$d";
+  } else if (data.normals.size() > 0) {
+    corner = " %1$d//%1$d";
+  } else {
+    corner = " %1$d";
+  }
+
+  bool written = WriteElements(f, "v", data.positions) &&
+      WriteElements(f, "vt", data.texcoords) &&
+      WriteElements(f, "vn", data.normals) &&
+      WriteLines(f, data.triangles.size() / 3,
+          [&](int i, std::vector<char>& text) {
+    Append(text, "f");
+    for (int j = 0; j < 3; j++) {
+      Append(text, corner, data.triangles[3 * i + j] + 1);
+    }
+    Append(text, "\n");
+  });
+  written = (fclose(f) == 0) && written;
+
+  if (!written) {
+    fprintf(stderr, "Failed writing %s\n", filename);
+  }
+  return written;
+}
+}  // namespace computer_graphics
@@ -0,0 +1,48 @@
+//! \author Stephen McGruer
+
+// Repairs meshes by welding duplicate vertices and removing degenerate
+// triangles, and writes them back out as OBJ files.
+
+#ifndef SRC_MESHWELD_H_
+#define SRC_MESHWELD_H_
+
+#include "./obj_loader.h"
+
+namespace computer_graphics {
+
+//! \brief Merges vertices that lie within epsilon of each other, and points
+//!        the triangles at the merged vertices.
+//!
+//! Vertices are bucketed in a hash grid of epsilon-sized cells, so each one
+//! is only compared with those in the surrounding 27 cells, and the
+//! comparisons run in parallel. Each vertex is merged into the first vertex
+//! in the file within epsilon of it, and chains of such vertices collapse
+//! into the first of the chain. Vertices with texture coordinates or normals
+//! only merge if those are within epsilon too. An epsilon of zero only
+//! merges exact duplicates.
+//!
+//! The merged-away vertices are left in place, unused; CompactVertices()
+//! removes them. Returns the number of vertices that were merged.
+int WeldVertices(float epsilon, ObjData& data);
+
+//! \brief Removes triangles that have a repeated vertex or no area.
+//!
+//! Returns the number of triangles removed.
+int RemoveDegenerateTriangles(ObjData& data);
+
+//! \brief Removes the vertices that no triangle uses, keeping the others in
+//!        order, and renumbers the triangles to match.
+//!
+//! Returns the number of vertices removed.
+int CompactVertices(ObjData& data);
+
+//! \brief Writes data as an OBJ file.
+//!
+//! Texture coordinates and normals are written if data has them, with one
+//! for each vertex. Floats are written with enough digits to read back
+//! exactly. Returns false, having printed the reason, if the file cannot be
+//! written.
+bool WriteObj(const char* filename, const ObjData& data);
+}  // namespace computer_graphics
+
+#endif  // SRC_MESHWELD_H_
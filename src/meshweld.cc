@@ -0,0 +1,126 @@
+//! \author Stephen McGruer
+
+//! A tool that repairs OBJ files for the renderer. Vertices that share the
+//! same point in space are welded into one, triangles that are left with no
+//! area are removed, and unused vertices are dropped.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "./job_system.h"
+#include "./mesh_optimiser.h"
+#include "./mesh_weld.h"
+#include "./obj_loader.h"
+#include "./teapot_utils.h"
+#include "./triangle_mesh.h"
+
+namespace cg = computer_graphics;
+
+void PrintUsage(const char*);
+
+int main(int argc, char **argv) {
+  float epsilon = 0.0f;
+  bool write_cache = false;
+  bool reorder = false;
+  const char* input_filename = NULL;
+  const char* output_filename = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      epsilon = atof(argv[++i]);
+      if (!(epsilon >= 0.0f)) {
+        fprintf(stderr, "Error: Epsilon must not be negative.\n\n");
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-c") == 0) {
+      write_cache = true;
+    } else if (strcmp(argv[i], "-r") == 0) {
+      reorder = true;
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      int num_threads = atoi(argv[++i]);
+      if (num_threads < 1) {
+        fprintf(stderr, "Error: Need at least one thread.\n\n");
+        PrintUsage(argv[0]);
+        return 1;
+      }
+      cg::SetJobThreads(num_threads);
+    } else if (input_filename == NULL) {
+      input_filename = argv[i];
+    } else if (output_filename == NULL) {
+      output_filename = argv[i];
+    } else {
+      input_filename = NULL;
+      break;
+    }
+  }
+
+  if (input_filename == NULL || output_filename == NULL) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  double start = cg::CurrentTime();
+  cg::ObjData data;
+  if (!cg::LoadObj(input_filename, false, data)) {
+    return 1;
+  }
+  const int num_vertices = data.positions.size();
+  const int num_triangles = data.triangles.size() / 3;
+  double loaded = cg::CurrentTime();
+
+  int welded = cg::WeldVertices(epsilon, data);
+  int degenerate = cg::RemoveDegenerateTriangles(data);
+  int unused = cg::CompactVertices(data) - welded;
+  float acmr = cg::AverageCacheMissRatio(data.triangles);
+  if (reorder) {
+    cg::OptimiseTriangleOrder(data.positions.size(), data.triangles);
+    cg::OptimiseVertexOrder(data);
+  }
+  double repaired = cg::CurrentTime();
+
+  if (!cg::WriteObj(output_filename, data)) {
+    return 1;
+  }
+  double written = cg::CurrentTime();
+
+  printf("Read %d vertices and %d triangles from %s in %.1f ms\n",
+      num_vertices, num_triangles, input_filename, (loaded - start) * 1000.0);
+  printf("Welded %d vertices, removed %d degenerate triangles and %d unused "
+      "vertices in %.1f ms\n", welded, degenerate, unused,
+      (repaired - loaded) * 1000.0);
+  if (reorder) {
+    printf("Reordered for the vertex cache: ACMR %.3f before, %.3f after\n",
+        acmr, cg::AverageCacheMissRatio(data.triangles));
+  } else {
+    printf("ACMR %.3f\n", acmr);
+  }
+  printf("Wrote %d vertices and %d triangles to %s in %.1f ms\n",
+      data.positions.size(), static_cast<int>(data.triangles.size() / 3),
+      output_filename, (written - repaired) * 1000.0);
+
+  if (write_cache) {
+    // Loading the mesh writes the cache that the renderer will use.
+    cg::TriangleMesh mesh;
+    mesh.LoadFile(output_filename);
+  }
+  return 0;
+}
+
+void PrintUsage(const char* program) {
+  fprintf(stderr, "Usage: %s [-e epsilon] [-r] [-c] [-t threads] "
+      "input_file output_file\n\n", program);
+  fprintf(stderr, "Welds together the vertices of input_file that are within "
+      "epsilon of each\nother (by default, only exact duplicates), removes "
+      "triangles with no area\nand vertices that are no longer used, and "
+      "writes the result to output_file\nas an OBJ file.\n\n");
+  fprintf(stderr, "The -r option also reorders the triangles and vertices "
+      "so that each\ntriangle reuses recently used vertices, and reports the "
+      "average cache miss\nratio (ACMR) before and after. The renderer does "
+      "this itself when it builds\nits mesh cache.\n\n");
+  fprintf(stderr, "The -c option also writes the binary mesh cache that the "
+      "renderer loads\nfor output_file, so that its first load need not "
+      "parse it.\n\n");
+  fprintf(stderr, "The -t option sets the number of threads used. By "
+      "default there is one\nper hardware thread.\n");
+}
@@ -0,0 +1,712 @@
+//! \author Stephen McGruer
+
+#include "./obj_loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "./job_system.h"
+#include "./mapped_file.h"
+
+namespace computer_graphics {
+
+namespace {
+//! Files are split into at most a few chunks per thread, and chunks are
+//! never made smaller than this, so that small files are parsed in one go.
+const size_t kMinChunkSize = 256 * 1024;
+
+//! An index that a face corner does not have.
+const int kNoIndex = -1;
+
+//! \brief The elements of one kind read from a chunk (positions, texture
+//!        coordinates or normals), and the face indices into them.
+//!
+//! Positive indices count from the start of the file, so are stored as
+//! zero-based indices straight away. Negative indices count back from the
+//! current element, and the number of elements in earlier chunks is not yet
+//! known, so they are stored relative to the chunk's first element and
+//! listed in relative_indices to be fixed up when the chunks are merged.
+struct ChunkElements {
+    VertexStream values;
+
+    //! One index per triangle corner.
+    std::vector<int> indices;
+
+    //! Positions in indices that are relative to the chunk.
+    std::vector<int> relative_indices;
+};
+
+//! The records parsed from one chunk of the file.
+struct Chunk {
+    const char* begin;
+    const char* end;
+
+    ChunkElements positions;
+
+    //! The texture coordinate and normal indices are only filled in once
+    //! the chunk sees a face that has them (has_attributes), so that files
+    //! of plain triangles do not pay for them.
+    ChunkElements texcoords;
+    ChunkElements normals;
+    bool has_attributes;
+
+    //! The start of the first malformed line, or NULL.
+    const char* error;
+
+    Chunk()
+        : begin(NULL),
+          end(NULL),
+          has_attributes(false),
+          error(NULL) {
+    }
+};
+
+//! A face corner: its position, texture coordinate and normal indices.
+struct Corner {
+    int position;
+    int texcoord;
+    int normal;
+
+    inline bool operator==(const Corner& other) const {
+      return position == other.position && texcoord == other.texcoord &&
+          normal == other.normal;
+    }
+};
+
+struct CornerHash {
+  inline size_t operator()(const Corner& corner) const {
+    return corner.position * 73856093u ^ corner.texcoord * 19349663u ^
+        corner.normal * 83492791u;
+  }
+};
+
+inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+inline void SkipSpaces(const char*& p, const char* end) {
+  while (p < end && IsSpace(*p)) {
+    p++;
+  }
+}
+
+//! Moves p to the start of the next line.
+inline void SkipLine(const char*& p, const char* end) {
+  const char* newline =
+      static_cast<const char*>(memchr(p, '\n', end - p));
+  p = (newline == NULL) ? end : newline + 1;
+}
+
+//! \brief Parses a float with strtof(), for the numbers that ParseFloat()
+//!        cannot handle exactly by itself.
+bool ParseFloatSlow(const char*& p, const char* end, float& value) {
+  // The file is not null terminated, so copy the token out first.
+  char token[64];
+  size_t length = 0;
+  while (p + length < end && !IsSpace(p[length]) && p[length] != '\n') {
+    if (length + 1 == sizeof(token)) {
+      return false;
+    }
+    token[length] = p[length];
+    length++;
+  }
+  token[length] = '\0';
+
+  char* token_end;
+  value = strtof(token, &token_end);
+  if (length == 0 || token_end != token + length) {
+    return false;
+  }
+  p += length;
+  return true;
+}
+
+//! \brief Parses a float, leaving p just after it.
+//!
+//! Numbers with at most seven significant digits and a small exponent, which
+//! covers nearly everything exported in practice, are converted with a
+//! single multiplication or division of two exactly representable floats.
+//! That is correctly rounded, so gives the same result as strtof().
+//! Anything else is handed to strtof().
+bool ParseFloat(const char*& p, const char* end, float& value) {
+  static const float kPowersOfTen[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+  };
+  const uint64_t kMaxExactMantissa = 1 << 24;
+
+  SkipSpaces(p, end);
+  const char* start = p;
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+  bool overflow = false;
+  for (; p < end && IsDigit(*p); p++, digits++) {
+    if (mantissa < UINT64_MAX / 10 - 9) {
+      mantissa = mantissa * 10 + (*p - '0');
+    } else {
+      overflow = true;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && IsDigit(*p); p++, digits++) {
+      if (mantissa < UINT64_MAX / 10 - 9) {
+        mantissa = mantissa * 10 + (*p - '0');
+        exponent--;
+      } else {
+        overflow = true;
+      }
+    }
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negative_exponent = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negative_exponent = (*p == '-');
+      p++;
+    }
+    int written_exponent = 0;
+    if (p == end || !IsDigit(*p)) {
+      overflow = true;
+    }
+    for (; p < end && IsDigit(*p); p++) {
+      written_exponent = std::min(written_exponent * 10 + (*p - '0'), 1000);
+    }
+    exponent += negative_exponent ? -written_exponent : written_exponent;
+  }
+
+  if (digits == 0 || overflow ||
+      (p < end && !IsSpace(*p) && *p != '\n')) {
+    // Not a plain decimal number (e.g. "inf"), or too long to parse here.
+    p = start;
+    return ParseFloatSlow(p, end, value);
+  }
+
+  // Trailing zeros are common ("1.500000"), and dropping them keeps more
+  // numbers within the exact range.
+  while (mantissa != 0 && mantissa % 10 == 0) {
+    mantissa /= 10;
+    exponent++;
+  }
+
+  if (mantissa == 0) {
+    value = 0.0f;
+  } else if (mantissa <= kMaxExactMantissa && exponent >= -10 &&
+      exponent <= 10) {
+    float significand = static_cast<float>(mantissa);
+    value = (exponent < 0) ? significand / kPowersOfTen[-exponent] :
+        significand * kPowersOfTen[exponent];
+  } else {
+    p = start;
+    return ParseFloatSlow(p, end, value);
+  }
+
+  if (negative) {
+    value = -value;
+  }
+  return true;
+}
+
+//! Parses an integer, leaving p just after it.
+bool ParseInt(const char*& p, const char* end, int& value) {
+  SkipSpaces(p, end);
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  if (p == end || !IsDigit(*p)) {
+    return false;
+  }
+  int64_t result = 0;
+  for (; p < end && IsDigit(*p); p++) {
+    result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+  }
+  value = negative ? -result : result;
+  return true;
+}
+
+//! Returns true if nothing but spaces or a comment is left on the line.
+inline bool AtLineEnd(const char*& p, const char* end) {
+  SkipSpaces(p, end);
+  return p == end || *p == '\n' || *p == '#';
+}
+
+//! A face corner as written in the file, for positions, texture
+//! coordinates and normals in that order.
+struct ParsedCorner {
+    int indices[3];
+    bool relative[3];
+};
+
+//! \brief Returns true if the corner has an index of the given kind.
+//!
+//! A relative index may legitimately be kNoIndex, when it refers to the
+//! last element of the previous chunk.
+inline bool HasIndex(const ParsedCorner& corner, int kind) {
+  return corner.indices[kind] != kNoIndex || corner.relative[kind];
+}
+
+//! \brief Parses an OBJ index into a zero-based index, which is relative to
+//!        the chunk's first element if the index was negative.
+//!
+//! Returns false for the invalid index 0.
+inline bool ParseIndex(const char*& p, const char* end,
+    const ChunkElements& elements, int& index, bool& relative) {
+  int written;
+  if (!ParseInt(p, end, written) || written == 0) {
+    return false;
+  }
+  relative = (written < 0);
+  index = relative ? elements.values.size() + written : written - 1;
+  return true;
+}
+
+//! \brief Parses a face corner: "v", "v/vt", "v//vn" or "v/vt/vn".
+bool ParseCorner(const char*& p, const char* end, const Chunk& chunk,
+    ParsedCorner& corner) {
+  const ChunkElements* elements[3] = {
+    &chunk.positions, &chunk.texcoords, &chunk.normals
+  };
+  corner.indices[1] = corner.indices[2] = kNoIndex;
+  corner.relative[1] = corner.relative[2] = false;
+
+  if (!ParseIndex(p, end, *elements[0], corner.indices[0],
+      corner.relative[0])) {
+    return false;
+  }
+  for (int i = 1; i < 3 && p < end && *p == '/'; i++) {
+    p++;
+    // The texture coordinate may be left out, as in "v//vn".
+    if (i == 1 && p < end && *p == '/') {
+      continue;
+    }
+    if (!ParseIndex(p, end, *elements[i], corner.indices[i],
+        corner.relative[i])) {
+      return false;
+    }
+  }
+  return p == end || IsSpace(*p) || *p == '\n';
+}
+
+//! Stores one triangle corner in the chunk.
+void StoreCorner(const ParsedCorner& corner, Chunk& chunk) {
+  ChunkElements* elements[3] = {
+    &chunk.positions, &chunk.texcoords, &chunk.normals
+  };
+
+  // Start tracking the other indices once a corner has them.
+  if (!chunk.has_attributes && (HasIndex(corner, 1) || HasIndex(corner, 2))) {
+    chunk.has_attributes = true;
+    chunk.texcoords.indices.resize(chunk.positions.indices.size(), kNoIndex);
+    chunk.normals.indices.resize(chunk.positions.indices.size(), kNoIndex);
+  }
+
+  const int kinds = chunk.has_attributes ? 3 : 1;
+  for (int i = 0; i < kinds; i++) {
+    if (corner.relative[i]) {
+      elements[i]->relative_indices.push_back(elements[i]->indices.size());
+    }
+    elements[i]->indices.push_back(corner.indices[i]);
+  }
+}
+
+//! \brief Parses the corners of a face, splitting polygons into a fan of
+//!        triangles around the first corner.
+bool ParseFace(const char*& p, const char* end, Chunk& chunk) {
+  // Plain triangles of positive position indices are by far the most
+  // common faces, so are read without any of the general machinery.
+  const char* start = p;
+  int v[3];
+  if (ParseInt(p, end, v[0]) && ParseInt(p, end, v[1]) &&
+      ParseInt(p, end, v[2]) && v[0] > 0 && v[1] > 0 && v[2] > 0 &&
+      AtLineEnd(p, end)) {
+    std::vector<int>& positions = chunk.positions.indices;
+    for (int i = 0; i < 3; i++) {
+      positions.push_back(v[i] - 1);
+      if (chunk.has_attributes) {
+        chunk.texcoords.indices.push_back(kNoIndex);
+        chunk.normals.indices.push_back(kNoIndex);
+      }
+    }
+    return true;
+  }
+  p = start;
+
+  ParsedCorner first;
+  ParsedCorner previous;
+  int corners = 0;
+  while (!AtLineEnd(p, end)) {
+    ParsedCorner corner;
+    if (!ParseCorner(p, end, chunk, corner)) {
+      return false;
+    }
+    if (corners == 0) {
+      first = corner;
+    } else if (corners >= 2) {
+      StoreCorner(first, chunk);
+      StoreCorner(previous, chunk);
+      StoreCorner(corner, chunk);
+    }
+    previous = corner;
+    corners++;
+  }
+  return corners >= 3;
+}
+
+//! Parses the lines in [chunk.begin, chunk.end).
+void ParseChunk(const char* file_end, Chunk& chunk) {
+  const char* p = chunk.begin;
+  while (p < chunk.end) {
+    const char* line = p;
+    SkipSpaces(p, file_end);
+
+    const char* keyword = p;
+    while (p < file_end && !IsSpace(*p) && *p != '\n') {
+      p++;
+    }
+    const size_t length = p - keyword;
+
+    bool parsed = true;
+    if (length == 1 && keyword[0] == 'v') {
+      // Any w component or vertex colour is ignored.
+      float x;
+      float y;
+      float z;
+      parsed = ParseFloat(p, file_end, x) && ParseFloat(p, file_end, y) &&
+          ParseFloat(p, file_end, z);
+      chunk.positions.values.push_back(x, y, z);
+    } else if (length == 1 && keyword[0] == 'f') {
+      parsed = ParseFace(p, file_end, chunk);
+    } else if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+      float x;
+      float y;
+      float z;
+      parsed = ParseFloat(p, file_end, x) && ParseFloat(p, file_end, y) &&
+          ParseFloat(p, file_end, z);
+      chunk.normals.values.push_back(x, y, z);
+    } else if (length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+      // The v and w coordinates are optional.
+      float uvw[3] = { 0.0f, 0.0f, 0.0f };
+      parsed = ParseFloat(p, file_end, uvw[0]);
+      for (int i = 1; i < 3 && parsed && !AtLineEnd(p, file_end); i++) {
+        parsed = ParseFloat(p, file_end, uvw[i]);
+      }
+      chunk.texcoords.values.push_back(uvw[0], uvw[1], uvw[2]);
+    }
+    if (!parsed) {
+      chunk.error = line;
+      return;
+    }
+
+    // Anything else (comments, groups, materials, ...) is ignored.
+    SkipLine(p, file_end);
+  }
+}
+
+//! Returns the line number of a position in the file, for error messages.
+int LineNumber(const MappedFile& file, const char* position) {
+  const char* begin = file.data();
+  return std::count(begin, position, '\n') + 1;
+}
+
+//! \brief Centres the positions on their mean and scales them so that the
+//!        larger of their x and y extents is 400 units.
+void Normalise(VertexStream& positions) {
+  const int count = positions.size();
+  if (count == 0) {
+    return;
+  }
+  Span<float> components[3] = { positions.x(), positions.y(), positions.z() };
+
+  // The mean is summed serially, in file order, as the rounding of a float
+  // sum depends on the order of the additions.
+  float mean[3] = { 0.0f, 0.0f, 0.0f };
+  for (int i = 0; i < count; i++) {
+    mean[0] += components[0][i];
+    mean[1] += components[1][i];
+    mean[2] += components[2][i];
+  }
+  for (int j = 0; j < 3; j++) {
+    mean[j] /= count;
+  }
+
+  // The bounds do not depend on the order, so each block finds its own and
+  // they are combined afterwards.
+  const int blocks = (count + kStreamBlockSize - 1) / kStreamBlockSize;
+  std::vector<float> block_bounds(4 * blocks);
+  Jobs().ParallelForBlocks(count, kStreamBlockSize, [&](int begin, int end) {
+    float* bounds = &block_bounds[4 * (begin / kStreamBlockSize)];
+    bounds[0] = bounds[1] = -10000;
+    bounds[2] = bounds[3] = 10000;
+    for (int i = begin; i < end; i++) {
+      bounds[0] = std::max(bounds[0], components[0][i]);
+      bounds[1] = std::max(bounds[1], components[1][i]);
+      bounds[2] = std::min(bounds[2], components[0][i]);
+      bounds[3] = std::min(bounds[3], components[1][i]);
+    }
+  });
+
+  float xmax = -10000;
+  float ymax = -10000;
+  float xmin = 10000;
+  float ymin = 10000;
+  for (int block = 0; block < blocks; block++) {
+    xmax = std::max(xmax, block_bounds[4 * block]);
+    ymax = std::max(ymax, block_bounds[4 * block + 1]);
+    xmin = std::min(xmin, block_bounds[4 * block + 2]);
+    ymin = std::min(ymin, block_bounds[4 * block + 3]);
+  }
+
+  float range;
+  if (xmax-xmin > ymax-ymin) {
+    range = xmax-xmin;
+  } else {
+    range = ymax-ymin;
+  }
+
+  Jobs().ParallelForBlocks(count, kStreamBlockSize, [&](int begin, int end) {
+    for (int j = 0; j < 3; j++) {
+      for (int i = begin; i < end; i++) {
+        components[j][i] = (components[j][i]-mean[j])/range*400;
+      }
+    }
+  });
+}
+
+//! One kind of element from every chunk, merged in file order.
+struct MergedElements {
+    VertexStream values;
+
+    //! One index per triangle corner, or kNoIndex.
+    std::vector<int> indices;
+};
+
+//! \brief Merges one kind of element from every chunk into merged, and
+//!        makes the chunks' relative indices absolute.
+//!
+//! Chunks that have no indices of this kind give kNoIndex for each of their
+//! corners. Returns false if an index is out of range.
+bool MergeElements(const std::vector<Chunk>& chunks,
+    ChunkElements Chunk::*kind, const std::vector<int>& corner_offsets,
+    MergedElements& merged) {
+  const int num_chunks = chunks.size();
+  std::vector<int> value_offsets(num_chunks + 1, 0);
+  for (int i = 0; i < num_chunks; i++) {
+    value_offsets[i + 1] =
+        value_offsets[i] + (chunks[i].*kind).values.size();
+  }
+  const int num_values = value_offsets[num_chunks];
+
+  merged.values.resize(num_values);
+  merged.indices.resize(corner_offsets[num_chunks]);
+  std::vector<char> valid(num_chunks, true);
+  Jobs().ParallelFor(num_chunks, [&](int i) {
+    const ChunkElements& elements = chunks[i].*kind;
+    const int offset = value_offsets[i];
+    std::copy(elements.values.x().begin(), elements.values.x().end(),
+        merged.values.x().begin() + offset);
+    std::copy(elements.values.y().begin(), elements.values.y().end(),
+        merged.values.y().begin() + offset);
+    std::copy(elements.values.z().begin(), elements.values.z().end(),
+        merged.values.z().begin() + offset);
+
+    int* indices = merged.indices.data() + corner_offsets[i];
+    const int num_corners = corner_offsets[i + 1] - corner_offsets[i];
+    if (elements.indices.empty()) {
+      std::fill(indices, indices + num_corners, kNoIndex);
+      return;
+    }
+    std::copy(elements.indices.begin(), elements.indices.end(), indices);
+
+    for (size_t j = 0; j < elements.relative_indices.size(); j++) {
+      int& index = indices[elements.relative_indices[j]];
+      index += offset;
+      if (index < 0 || index >= num_values) {
+        valid[i] = false;
+      }
+    }
+    for (int j = 0; j < num_corners; j++) {
+      if (indices[j] < kNoIndex || indices[j] >= num_values) {
+        valid[i] = false;
+      }
+    }
+  });
+
+  return std::find(valid.begin(), valid.end(), false) == valid.end();
+}
+
+//! \brief Gives each distinct combination of position, texture coordinate
+//!        and normal its own vertex, so that one index per corner covers all
+//!        three, and writes the result to data.
+//!
+//! Each position keeps its index for the first combination that it appears
+//! in, so the vertex order is unchanged for files where every position has
+//! one texture coordinate and normal. Other combinations, such as a
+//! position on a hard edge, become new vertices after them.
+void Weld(const MergedElements& positions, const MergedElements* texcoords,
+    const MergedElements* normals, ObjData& data) {
+  const int num_positions = positions.values.size();
+  const int num_corners = positions.indices.size();
+
+  std::vector<Corner> vertices(num_positions);
+  std::vector<bool> seen(num_positions, false);
+  for (int i = 0; i < num_positions; i++) {
+    Corner unused = { i, kNoIndex, kNoIndex };
+    vertices[i] = unused;
+  }
+
+  std::unordered_map<Corner, int, CornerHash> extra_vertices;
+  data.triangles.resize(num_corners);
+  for (int i = 0; i < num_corners; i++) {
+    Corner corner = {
+      positions.indices[i],
+      texcoords != NULL ? texcoords->indices[i] : kNoIndex,
+      normals != NULL ? normals->indices[i] : kNoIndex
+    };
+
+    if (!seen[corner.position]) {
+      seen[corner.position] = true;
+      vertices[corner.position] = corner;
+      data.triangles[i] = corner.position;
+    } else if (vertices[corner.position] == corner) {
+      data.triangles[i] = corner.position;
+    } else {
+      std::pair<std::unordered_map<Corner, int, CornerHash>::iterator, bool>
+          inserted = extra_vertices.insert(
+              std::make_pair(corner, static_cast<int>(vertices.size())));
+      if (inserted.second) {
+        vertices.push_back(corner);
+      }
+      data.triangles[i] = inserted.first->second;
+    }
+  }
+
+  const int num_vertices = vertices.size();
+  data.positions.resize(num_vertices);
+  data.texcoords.resize(texcoords != NULL ? num_vertices : 0);
+  data.normals.resize(normals != NULL ? num_vertices : 0);
+  Jobs().ParallelForBlocks(num_vertices, kStreamBlockSize,
+      [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      const Corner& vertex = vertices[i];
+      Vertex position = positions.values.Get(vertex.position);
+      data.positions.Set(i, position[0], position[1], position[2]);
+
+      if (texcoords != NULL) {
+        Vertex texcoord = (vertex.texcoord != kNoIndex) ?
+            texcoords->values.Get(vertex.texcoord) : Vertex();
+        data.texcoords.Set(i, texcoord[0], texcoord[1], texcoord[2]);
+      }
+      if (normals != NULL) {
+        Vertex normal = (vertex.normal != kNoIndex) ?
+            normals->values.Get(vertex.normal) : Vertex();
+        data.normals.Set(i, normal[0], normal[1], normal[2]);
+      }
+    }
+  });
+}
+}  // namespace
+
+bool LoadObj(const char* filename, bool normalise, ObjData& data) {
+  MappedFile file;
+  if (!file.Open(filename)) {
+    fprintf(stderr, "Failed reading polygon data file %s\n", filename);
+    return false;
+  }
+  const char* file_end = file.data() + file.size();
+
+  // Split the file into chunks of whole lines. Each chunk starts at the
+  // first line that begins after its share of the file does.
+  const int max_chunks = std::max<size_t>(1, file.size() / kMinChunkSize);
+  const int num_chunks = std::min(max_chunks, 4 * Jobs().num_threads());
+  std::vector<Chunk> chunks(num_chunks);
+  for (int i = 0; i < num_chunks; i++) {
+    const char* begin = file.data() + file.size() * i / num_chunks;
+    if (i > 0 && begin[-1] != '\n') {
+      SkipLine(begin, file_end);
+    }
+    chunks[i].begin = begin;
+    if (i > 0) {
+      chunks[i - 1].end = begin;
+    }
+  }
+  chunks[num_chunks - 1].end = file_end;
+
+  Jobs().ParallelFor(num_chunks, [&](int i) {
+    ParseChunk(file_end, chunks[i]);
+  });
+
+  std::vector<int> corner_offsets(num_chunks + 1, 0);
+  bool has_attributes = false;
+  for (int i = 0; i < num_chunks; i++) {
+    if (chunks[i].error != NULL) {
+      fprintf(stderr, "Failed parsing %s: malformed record on line %d\n",
+          filename, LineNumber(file, chunks[i].error));
+      return false;
+    }
+    corner_offsets[i + 1] =
+        corner_offsets[i] + chunks[i].positions.indices.size();
+    has_attributes = has_attributes || chunks[i].has_attributes;
+  }
+
+  // Merge the chunks, in file order.
+  MergedElements positions;
+  MergedElements texcoords;
+  MergedElements normals;
+  bool valid = MergeElements(chunks, &Chunk::positions, corner_offsets,
+      positions);
+  if (has_attributes) {
+    valid = valid &&
+        MergeElements(chunks, &Chunk::texcoords, corner_offsets, texcoords) &&
+        MergeElements(chunks, &Chunk::normals, corner_offsets, normals);
+  }
+  if (!valid) {
+    fprintf(stderr, "Failed parsing %s: face refers to a missing vertex\n",
+        filename);
+    return false;
+  }
+
+  if (normalise) {
+    Normalise(positions.values);
+  }
+
+  // Texture coordinates are kept if any corner has one, and normals only if
+  // every corner has one; otherwise the mesh computes its own.
+  const bool use_texcoords = std::find_if(texcoords.indices.begin(),
+      texcoords.indices.end(), [](int index) { return index != kNoIndex; }) !=
+      texcoords.indices.end();
+  const bool use_normals = !normals.indices.empty() &&
+      std::find(normals.indices.begin(), normals.indices.end(), kNoIndex) ==
+      normals.indices.end();
+  if (use_texcoords || use_normals) {
+    Weld(positions, use_texcoords ? &texcoords : NULL,
+        use_normals ? &normals : NULL, data);
+  } else {
+    data.positions = std::move(positions.values);
+    data.triangles = std::move(positions.indices);
+    data.texcoords.clear();
+    data.normals.clear();
+  }
+
+  data.file_size = file.size();
+  return true;
+}
+}  // namespace computer_graphics
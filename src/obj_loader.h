@@ -0,0 +1,55 @@
+//! \author Stephen McGruer
+
+// Reads Wavefront OBJ files.
+
+#ifndef SRC_OBJLOADER_H_
+#define SRC_OBJLOADER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "./vertex_stream.h"
+
+namespace computer_graphics {
+
+//! \struct ObjData
+//! \brief The geometry read from an OBJ file.
+struct ObjData {
+    VertexStream positions;
+
+    //! The texture coordinates (u, v, w) and normals of each vertex, if the
+    //! file gives them; otherwise empty.
+    VertexStream texcoords;
+    VertexStream normals;
+
+    //! Three zero-based vertex indices per triangle.
+    std::vector<int> triangles;
+
+    //! The size of the file, in bytes.
+    size_t file_size;
+
+    ObjData()
+        : file_size(0) {
+    }
+};
+
+//! \brief Reads the vertices and triangles of an OBJ file into data.
+//!
+//! The file is memory mapped and split into chunks of whole lines, which are
+//! parsed in parallel on the job system and then merged in file order.
+//!
+//! Faces may use the "v", "v/vt", "v//vn" and "v/vt/vn" forms and negative
+//! (relative) indices. Polygons are split into triangles. Where the faces
+//! pair a position with more than one texture coordinate or normal, the
+//! position is given one vertex per combination. Normals are only kept if
+//! every face corner has one, and are not normalised.
+//!
+//! If normalise is set, the positions are then centred on their mean and
+//! scaled so that the larger of their x and y extents is 400 units.
+//!
+//! Returns false, having printed the reason, if the file cannot be read or
+//! contains a malformed record.
+bool LoadObj(const char* filename, bool normalise, ObjData& data);
+}  // namespace computer_graphics
+
+#endif  // SRC_OBJLOADER_H_
@@ -0,0 +1,155 @@
+//! \author Stephen McGruer
+
+#include "./clipper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace computer_graphics {
+
+namespace {
+//! Clipped triangles are kept well inside the guard band, so that rounding
+//! in the projection cannot push a vertex outside it.
+const float kClipGuardBand = kGuardBand / 2;
+
+//! The near plane and the four sides of the guard band.
+const int kNumClipPlanes = 5;
+
+//! Clipping a triangle against each plane can add one vertex.
+const int kMaxClippedVertices = 3 + kNumClipPlanes;
+
+//! A vertex of a clipped triangle: its position relative to the viewpoint,
+//! and its barycentric coordinates within the whole triangle.
+struct ClipVertex {
+  float position[3];
+  float barycentrics[3];
+};
+
+//! \brief Clips a convex polygon to the side of a plane where
+//!        a * x + b * y + c * z + d >= 0. Returns the number of vertices
+//!        left.
+int ClipPolygon(const ClipVertex* in, int count, const float* plane,
+    ClipVertex* out) {
+  int out_count = 0;
+  for (int i = 0; i < count; i++) {
+    const ClipVertex& a = in[i];
+    const ClipVertex& b = in[(i + 1) % count];
+    float distance_a = plane[0] * a.position[0] + plane[1] * a.position[1] +
+        plane[2] * a.position[2] + plane[3];
+    float distance_b = plane[0] * b.position[0] + plane[1] * b.position[1] +
+        plane[2] * b.position[2] + plane[3];
+
+    if (distance_a >= 0.0f) {
+      out[out_count++] = a;
+    }
+    if ((distance_a >= 0.0f) != (distance_b >= 0.0f)) {
+      // The edge crosses the plane.
+      float t = distance_a / (distance_a - distance_b);
+      ClipVertex& v = out[out_count++];
+      for (int j = 0; j < 3; j++) {
+        v.position[j] = a.position[j] + t * (b.position[j] - a.position[j]);
+        v.barycentrics[j] =
+            a.barycentrics[j] + t * (b.barycentrics[j] - a.barycentrics[j]);
+      }
+    }
+  }
+  return out_count;
+}
+}  // namespace
+
+TriangleFate SetupPerspectiveTriangle(const VertexStream& positions,
+    const VertexStream& projected, const Triangle& triangle,
+    Vertex view_position, const WindowInfo& window_info, CullMode cull,
+    ClippedTriangle& clipped) {
+  Vertex p1 = projected.Get(triangle[0]);
+  Vertex p2 = projected.Get(triangle[1]);
+  Vertex p3 = projected.Get(triangle[2]);
+
+  // The projected z is the depth in view space. NaNs fail every comparison,
+  // and are left to the clipper.
+  bool inside = true;
+  const Vertex* corners[] = { &p1, &p2, &p3 };
+  for (int i = 0; i < 3; i++) {
+    const Vertex& p = *corners[i];
+    inside = inside && p[2] <= -kNearPlane &&
+        std::fabs(p[0]) <= kGuardBand && std::fabs(p[1]) <= kGuardBand;
+  }
+  if (inside) {
+    return SetupTriangle(p1, p2, p3, window_info, cull, clipped);
+  }
+
+  clipped.count = 0;
+  ClipVertex polygon[kMaxClippedVertices];
+  int count = 3;
+  int behind = 0;
+  for (int i = 0; i < 3; i++) {
+    Vertex position = positions.Get(triangle[i]);
+    for (int j = 0; j < 3; j++) {
+      polygon[i].position[j] = position[j] - view_position[j];
+      polygon[i].barycentrics[j] = (i == j) ? 1.0f : 0.0f;
+    }
+    if (polygon[i].position[2] > -kNearPlane) {
+      behind++;
+    }
+  }
+  if (behind == 3) {
+    return kTriangleRejected;
+  }
+
+  // Project() puts x at (-2x / z) * width / 2, so it lies within the guard
+  // band where kClipGuardBand * -z -/+ width * x >= 0, and likewise for y.
+  int width = std::abs(window_info.left) + std::abs(window_info.right);
+  int height = std::abs(window_info.top) + std::abs(window_info.bottom);
+  const float half_width = width / 2;
+  const float half_height = height / 2;
+  const float planes[kNumClipPlanes][4] = {
+    { 0.0f, 0.0f, -1.0f, -kNearPlane },
+    { -2.0f * half_width, 0.0f, -kClipGuardBand, 0.0f },
+    { 2.0f * half_width, 0.0f, -kClipGuardBand, 0.0f },
+    { 0.0f, -2.0f * half_height, -kClipGuardBand, 0.0f },
+    { 0.0f, 2.0f * half_height, -kClipGuardBand, 0.0f },
+  };
+  for (int i = 0; i < kNumClipPlanes && count >= 3; i++) {
+    ClipVertex clipped_polygon[kMaxClippedVertices];
+    count = ClipPolygon(polygon, count, planes[i], clipped_polygon);
+    std::copy(clipped_polygon, clipped_polygon + count, polygon);
+  }
+
+  // Project what is left as Project() does, and set it up as a fan of
+  // triangles around its first vertex.
+  const float dist = -2.0f;
+  Vertex window[kMaxClippedVertices];
+  for (int i = 0; i < count; i++) {
+    const float* position = polygon[i].position;
+    window[i] = Vertex(((dist * position[0]) / position[2]) * half_width,
+        ((dist * position[1]) / position[2]) * half_height, position[2]);
+  }
+
+  bool culled = false;
+  for (int i = 1; i + 1 < count; i++) {
+    TriangleSetup& setup = clipped.setups[clipped.count];
+    TriangleFate fate = SetupTriangle(window[0], window[i], window[i + 1],
+        window_info, cull, setup);
+    if (fate == kTriangleCulled) {
+      culled = true;
+    }
+    if (fate != kTriangleDrawn) {
+      continue;
+    }
+
+    setup.clipped = true;
+    const int piece[] = { 0, i, i + 1 };
+    for (int j = 0; j < 3; j++) {
+      std::copy(polygon[piece[j]].barycentrics,
+          polygon[piece[j]].barycentrics + 3, setup.barycentrics[j]);
+    }
+    clipped.count++;
+  }
+
+  if (clipped.count > 0) {
+    return kTriangleClipped;
+  }
+  return culled ? kTriangleCulled : kTriangleRejected;
+}
+}  // namespace computer_graphics
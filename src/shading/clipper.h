@@ -0,0 +1,34 @@
+//! \author Stephen McGruer
+
+// Clipping of triangles that are seen in perspective.
+
+#ifndef SRC_SHADING_CLIPPER_H_
+#define SRC_SHADING_CLIPPER_H_
+
+#include "./rasterizer.h"
+#include "../teapot_utils.h"
+#include "../triangle.h"
+#include "../vertex.h"
+#include "../vertex_stream.h"
+
+namespace computer_graphics {
+
+//! How far in front of the viewpoint triangles are clipped.
+const float kNearPlane = 1.0f;
+
+//! \brief Sets up a triangle for rasterization as seen from view_position.
+//!
+//! positions holds the mesh's world-space vertices, and projected the same
+//! vertices projected by ProjectPoints() for the window. A triangle that
+//! lies in front of the near plane and inside the guard band is set up from
+//! its projected vertices, exactly as by SetupTriangle(). Any other triangle
+//! is clipped against both in view space first, so that no point behind the
+//! viewer goes through the perspective divide, and each piece that is left
+//! is set up.
+TriangleFate SetupPerspectiveTriangle(const VertexStream& positions,
+    const VertexStream& projected, const Triangle& triangle,
+    Vertex view_position, const WindowInfo& window_info, CullMode cull,
+    ClippedTriangle& clipped);
+}  // namespace computer_graphics
+
+#endif  // SRC_SHADING_CLIPPER_H_
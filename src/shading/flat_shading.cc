@@ -4,61 +4,66 @@
 
 namespace computer_graphics {
 
-//! A z-buffer approach is used to draw points in the correct order. Note that
-//! multiple entries may exist in points for a single coordinate, so the drawing
-//! must be done by iterating from the front of the points vector to the back.
-void FlatShading::Shade(TriangleMesh object, TriangleMesh the_floor,
+//! A z-buffer approach is used to draw points in the correct order; the depth
+//! plane of the framebuffer serves as the z-buffer.
+void FlatShading::Shade(TriangleMesh& object, TriangleMesh& the_floor,
     WindowInfo window_info, Vertex light_position, Vertex view_position,
-    std::vector<Vertex>& points, IplImage* image) {
-  int window_width = std::abs(window_info.left) + std::abs(window_info.right);
-  int window_height = std::abs(window_info.top) + std::abs(window_info.bottom);
+    Framebuffer& framebuffer, IplImage* image) {
+  // Transform the meshes' vertices into world space in one batch, before any
+  // jobs start reading them.
+  object.UpdateVertices();
+  the_floor.UpdateVertices();
 
   // Initialise the z-buffer.
-  std::vector<std::vector<float>  > z_buffer;
-  for (int i = 0; i <= window_width; i++) {
-    std::vector<float> line(window_height + 1, -1000.0f);
-    z_buffer.push_back(line);
-  }
-
-  // Flat shading doesn't implement shadows.
-  std::vector<std::vector<float> > shadow_buffer;
-
-  RenderObject(object, window_info, light_position, view_position, z_buffer,
-      points);
-  RenderFloor(the_floor, window_info, light_position, view_position, z_buffer,
-      shadow_buffer, points);
+  framebuffer.Clear();
+
+  RenderWithDepthPrepass([&]() {
+    RenderObject(object, window_info, light_position, view_position,
+        framebuffer);
+
+    // Flat shading doesn't implement shadows.
+    RenderFloor(the_floor, window_info, light_position, view_position, NULL,
+        framebuffer);
+  });
+
+  // Average the samples of a multisampled framebuffer into its colours.
+  framebuffer.Resolve();
 }
 
-void FlatShading::RenderObject(TriangleMesh the_object,
+void FlatShading::RenderObject(TriangleMesh& the_object,
     WindowInfo window_info, Vertex light_position, Vertex view_position,
-    std::vector<std::vector<float> >& z_buffer,
-    std::vector<Vertex>& points) {
+    Framebuffer& framebuffer) {
   int window_width = std::abs(window_info.left) + std::abs(window_info.right);
   int window_height = std::abs(window_info.top) + std::abs(window_info.bottom);
 
-  Vertex p1;
-  Vertex p2;
-  Vertex p3;
-  for (int i = 0; i < the_object.trigNum(); i++) {
-    the_object.GetTriangleVertices(i, p1, p2, p3);
-
-    Vertex normal;
-    ComputeSurfaceNormal(p1, p2, p3, normal);
-
-    // Now we need to project them.
-    Project(p1, view_position, window_width, window_height);
-    Project(p2, view_position, window_width, window_height);
-    Project(p3, view_position, window_width, window_height);
-
-    // For efficiency, establish a bounding box for the triangle.
-    int left = clamp(std::min(p1[0], std::min(p2[0], p3[0])),
-        window_info.left, window_info.right);
-    int right = clamp(std::max(p1[0], std::max(p2[0], p3[0])),
-        window_info.left, window_info.right);
-    int top = clamp(std::min(p1[1], std::min(p2[1], p3[1])),
-        window_info.top, window_info.bottom);
-    int bottom = clamp(std::max(p1[1], std::max(p2[1], p3[1])),
-        window_info.top, window_info.bottom);
+  // The mesh caches its normals between frames.
+  const VertexStream& triangle_normals = the_object.triangle_normals();
+
+  // Project every vertex once, rather than once per triangle that uses it.
+  const VertexStream& positions = the_object.positions();
+  ProjectPoints(positions, view_position, window_width, window_height,
+      projected_vertices_);
+
+  // Set up the triangles in the object, and shade them.
+  std::vector<TriangleSetup> triangles;
+  std::vector<float> colours(3 * the_object.trigNum());
+  SetupTriangles(the_object.trigNum(), triangles,
+      [&](int i, ClippedTriangle& clipped) -> TriangleFate {
+    const Triangle& vertices = the_object.triangle(i);
+    Vertex p1 = projected_vertices_.Get(vertices[0]);
+    Vertex p2 = projected_vertices_.Get(vertices[1]);
+    Vertex p3 = projected_vertices_.Get(vertices[2]);
+
+    Vertex normal = triangle_normals.Get(i);
+
+    // Set up the triangle's edge functions and bounding box, clipping it
+    // first if it crosses the near plane.
+    TriangleFate fate = SetupPerspectiveTriangle(positions,
+        projected_vertices_, vertices, view_position, window_info,
+        cull_mode(), clipped);
+    if (clipped.count == 0) {
+      return fate;
+    }
 
     // Flat shading computes shading information based on the centroid
     // of the triangle.
@@ -85,17 +90,20 @@ void FlatShading::RenderObject(TriangleMesh the_object,
     clampf(green, 0.0f, 1.0f);
     clampf(blue, 0.0f, 1.0f);
 
-    for (int y = top; y <= bottom; y++) {
-      for (int x = left; x <= right; x++) {
-        if (!InTriangle(x, y, p1, p2, p3) ||
-            z_buffer[x + window_width / 2][y + window_height / 2] > z) {
-          continue;
-        }
-        z_buffer[x + window_width / 2][y + window_height / 2] = z;
-
-        points.push_back(Vertex(x, y, z, red, green, blue));
-      }
-    }
-  }
+    colours[3 * i] = red;
+    colours[3 * i + 1] = green;
+    colours[3 * i + 2] = blue;
+
+    // The whole triangle is drawn at the centroid's depth.
+    SetConstantDepth(z, clipped);
+    return fate;
+  });
+
+  // Render the triangles in the object.
+  DrawTriangles(triangles, framebuffer,
+      [&](int triangle, int x, int y, float, float, float, float) {
+    const float* colour = &colours[3 * triangle];
+    framebuffer.SetColour(x, y, colour[0], colour[1], colour[2]);
+  });
 }
 }
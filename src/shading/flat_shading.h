@@ -14,25 +14,28 @@ class FlatShading : public ShadingAlgorithm {
     inline FlatShading() { };
 
     //! \brief Calculates the shading for each visible triangle in the mesh, and
-    //!        places it in the points variable.
+    //!        writes it into the framebuffer.
     //!
     //! Each pixel in a triangle is shaded using the triangle's normal and using
     //! the centroid of the triangle to determine the light and view vectors.
     //!
     //! The image variable is ignored.
-    void Shade(TriangleMesh object, TriangleMesh the_floor, WindowInfo window_info,
-        Vertex light_position, Vertex view_position, std::vector<Vertex>& points,
+    void Shade(TriangleMesh& object, TriangleMesh& the_floor, WindowInfo window_info,
+        Vertex light_position, Vertex view_position, Framebuffer& framebuffer,
         IplImage* image = NULL);
 
   private:
     //! \brief Renders an object in the scene.
     //!
-    //! Expects the z-buffer to be already initialised. Takes control of it during
-    //! the function, and will update it.
-    void RenderObject(TriangleMesh the_object, WindowInfo window_info,
+    //! Expects the framebuffer to be already initialised. Visible pixels are
+    //! written to both its colour and depth planes.
+    void RenderObject(TriangleMesh& the_object, WindowInfo window_info,
         Vertex light_position, Vertex view_position,
-        std::vector<std::vector<float> >& z_buffer,
-        std::vector<Vertex>& points);
+        Framebuffer& framebuffer);
+
+    //! The object's vertices projected to the screen. Kept between frames to
+    //! avoid reallocating it.
+    VertexStream projected_vertices_;
 };
 }
 
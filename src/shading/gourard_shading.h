@@ -14,26 +14,29 @@ class GourardShading : public ShadingAlgorithm {
     inline GourardShading() { };
 
     //! \brief Calculates the shading for each visible triangle in the mesh, and
-    //!        places it in the points variable.
+    //!        writes it into the framebuffer.
     //!
     //! Each pixel in a triangle is shaded by calculating the shading at each of
     //! the triangle's vertices, then interpolating the three shadings for each
     //! point.
     //!
     //! The image variable is ignored.
-    void Shade(TriangleMesh object, TriangleMesh the_floor, WindowInfo window_info,
-        Vertex light_position, Vertex view_position, std::vector<Vertex>& points,
+    void Shade(TriangleMesh& object, TriangleMesh& the_floor, WindowInfo window_info,
+        Vertex light_position, Vertex view_position, Framebuffer& framebuffer,
         IplImage* image = NULL);
 
   private:
     //! \brief Renders an object in the scene.
     //!
-    //! Expects the z-buffer to be already initialised. Takes control of it during
-    //! the function, and will update it.
-    void RenderObject(TriangleMesh the_object, WindowInfo window_info,
+    //! Expects the framebuffer to be already initialised. Visible pixels are
+    //! written to both its colour and depth planes.
+    void RenderObject(TriangleMesh& the_object, WindowInfo window_info,
         Vertex light_position, Vertex view_position,
-        std::vector<std::vector<float> >& z_buffer,
-        std::vector<Vertex>& points);
+        Framebuffer& framebuffer);
+
+    //! The object's vertices projected to the screen. Kept between frames to
+    //! avoid reallocating it.
+    VertexStream projected_vertices_;
 };
 }
 
@@ -4,47 +4,103 @@
 #define SRC_SHADING_PHONGSHADING_H_
 
 #include "./shading_algorithm.h"
+#include "../g_buffer.h"
 
 namespace computer_graphics {
 
 //! \class PhongShading
 //! \brief Shades a scene using the Phong shading approach.
+//!
+//! By default each fragment is shaded as soon as it passes the depth test,
+//! so fragments that are later hidden are shaded for nothing. In deferred
+//! mode, the object's normals and the floor are first rasterized into a
+//! G-buffer, and each visible pixel is then shaded exactly once.
 class PhongShading : public ShadingAlgorithm {
   public:
-    inline PhongShading() { };
+    inline PhongShading() : deferred_(false) { };
 
     //! \brief Calculates the shading for each visible triangle in the mesh, and
-    //!        places it in the points variable.
+    //!        writes it into the framebuffer.
     //!
     //! Each pixel in a triangle is shaded by calculating the normals at each of
     //! the triangle's vertices, then interpolating the three normals for each
     //! point.
     //!
+    //! In deferred mode, the shading of each pixel is the same, but only the
+    //! visible ones are shaded. Deferred shading does not multisample, so a
+    //! multisampled framebuffer is always shaded as each fragment is drawn.
+    //!
     //! The image variable is ignored.
-    void Shade(TriangleMesh object, TriangleMesh the_floor, WindowInfo window_info,
-        Vertex light_position, Vertex view_position, std::vector<Vertex>& points,
+    void Shade(TriangleMesh& object, TriangleMesh& the_floor, WindowInfo window_info,
+        Vertex light_position, Vertex view_position, Framebuffer& framebuffer,
         IplImage* image = NULL);
 
+    //! Whether the scene is shaded through a G-buffer.
+    inline bool deferred() const { return deferred_; }
+    inline void set_deferred(bool deferred) { deferred_ = deferred; }
+
   private:
-    //! \brief Calculates the shadow buffer for an arbitrary object.
+    //! \brief Renders an arbitrary object into the shadow buffer.
     //!
-    //! If the shadow buffer is already initialised, it is preserved and updated
-    //! in the function.
-    void CalculateShadowBuffer(TriangleMesh the_object, WindowInfo window_info,
-        Vertex light_position, std::vector<std::vector<float> >& shadow_buffer);
+    //! Expects the shadow buffer to be already initialised; its contents are
+    //! preserved and updated in the function.
+    void CalculateShadowBuffer(TriangleMesh& the_object, WindowInfo window_info,
+        Vertex light_position, DepthBuffer& shadow_buffer);
+
+    //! \brief Projects an object's vertices to the camera's viewpoint, and
+    //!        sets up its triangles for rasterizing.
+    void SetupObjectTriangles(TriangleMesh& the_object, WindowInfo window_info,
+        Vertex view_position, std::vector<TriangleSetup>& triangles);
+
+    //! \brief Sets the colour of the object at pixel (x, y), which is at
+    //!        depth z and has the given interpolated normal, in the
+    //!        framebuffer.
+    void ShadeObjectPoint(const Vertex& normal, int x, int y, float z,
+        Vertex light_position, Vertex view_position,
+        const DepthBuffer& shadow_buffer, Framebuffer& framebuffer);
 
     //! \brief Renders an object in the scene.
     //!
-    //! Expects the z-buffer to be already initialised. Takes control of it during
-    //! the function, and will update it.
+    //! Expects the framebuffer to be already initialised. Visible pixels are
+    //! written to both its colour and depth planes.
     //!
-    //! If the shadow_buffer is not empty, will use it to attempt to render
-    //! shadows as well.
-    void RenderObject(TriangleMesh the_object, WindowInfo window_info,
+    //! If shadows are turned on, will use the shadow_buffer to attempt to
+    //! render shadows as well. The shadow buffer may still be being built by
+    //! the shadow_pass job; it is waited on before any pixels are shaded.
+    void RenderObject(TriangleMesh& the_object, WindowInfo window_info,
         Vertex light_position, Vertex view_position,
-        std::vector<std::vector<float> >& z_buffer,
-        std::vector<std::vector<float> > shadow_buffer,
-        std::vector<Vertex>& points);
+        const JobHandle& shadow_pass, const DepthBuffer& shadow_buffer,
+        Framebuffer& framebuffer);
+
+    //! \brief Rasterizes the object and the floor into the G-buffer, against
+    //!        the framebuffer's depth plane.
+    //!
+    //! Expects the framebuffer to be already initialised. Only depths are
+    //! written to the framebuffer.
+    void RenderGBuffer(TriangleMesh& the_object, TriangleMesh& the_floor,
+        WindowInfo window_info, Vertex view_position, Framebuffer& framebuffer);
+
+    //! \brief Shades each pixel that the G-buffer shows the object or the
+    //!        floor at, writing its colour into the framebuffer.
+    //!
+    //! Expects the shadow buffer to be finished, if shadows are turned on.
+    void LightGBuffer(Vertex light_position, Vertex view_position,
+        const DepthBuffer& shadow_buffer, Framebuffer& framebuffer);
+
+    bool deferred_;
+
+    //! The G-buffer used in deferred mode. Kept between frames to avoid
+    //! reallocating it.
+    GBuffer g_buffer_;
+
+    //! The depths seen from the light's viewpoint. Kept between frames to
+    //! avoid reallocating it.
+    DepthBuffer shadow_buffer_;
+
+    //! The vertices projected to the light's and the camera's viewpoints.
+    //! These are separate, as the shadow pass runs alongside the camera pass.
+    VertexStream light_projected_vertices_;
+    VertexStream projected_vertices_;
 };
 }
 
@@ -0,0 +1,518 @@
+//! \author Stephen McGruer
+
+#include "./rasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RASTERIZER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace computer_graphics {
+
+namespace {
+
+//! \brief Sets edge function i of the setup to the line through (ax, ay) and
+//!        (bx, by):
+//! f_ab(x, y) = (y_a - y_b)x + (x_b - x_a)y + (x_a * y_b) - (x_b * y_a)
+void SetEdge(int i, int ax, int ay, int bx, int by, TriangleSetup& setup) {
+  setup.a[i] = ay - by;
+  setup.b[i] = bx - ax;
+  setup.c[i] = (ax * by) - (bx * ay);
+}
+
+int RasterizeSpanScalar(const TriangleSetup& setup, int x, int count,
+    int e0, int e1, int e2, float* depth, Fragment* fragments) {
+  int num_fragments = 0;
+  for (int i = 0; i < count; i++) {
+    // A pixel is inside the triangle if no edge function is negative.
+    if ((e0 | e1 | e2) >= 0) {
+      float beta = e1 * setup.inv_area;
+      float gamma = e2 * setup.inv_area;
+      float z = setup.z + beta * setup.dz_beta + gamma * setup.dz_gamma;
+
+      // Skip hidden pixels.
+      if (!(depth[i] > z)) {
+        depth[i] = z;
+
+        Fragment& fragment = fragments[num_fragments++];
+        fragment.x = x + i;
+        fragment.z = z;
+        fragment.alpha = e0 * setup.inv_area;
+        fragment.beta = beta;
+        fragment.gamma = gamma;
+      }
+    }
+
+    e0 += setup.a[0];
+    e1 += setup.a[1];
+    e2 += setup.a[2];
+  }
+  return num_fragments;
+}
+
+#ifdef RASTERIZER_X86_KERNELS
+//! \brief Adds the lanes set in mask to the fragments, given the lanes'
+//!        depths and barycentric coordinates.
+inline int EmitFragments(int x, int mask, const float* z, const float* alpha,
+    const float* beta, const float* gamma, Fragment* fragments) {
+  int num_fragments = 0;
+  while (mask != 0) {
+    int lane = __builtin_ctz(mask);
+    mask &= mask - 1;
+
+    Fragment& fragment = fragments[num_fragments++];
+    fragment.x = x + lane;
+    fragment.z = z[lane];
+    fragment.alpha = alpha[lane];
+    fragment.beta = beta[lane];
+    fragment.gamma = gamma[lane];
+  }
+  return num_fragments;
+}
+
+//! Works on four pixels at a time. The arithmetic is done in the same order
+//! as the scalar kernel, so the results are identical.
+__attribute__((target("sse2")))
+int RasterizeSpanSse2(const TriangleSetup& setup, int x, int count,
+    int e0, int e1, int e2, float* depth, Fragment* fragments) {
+  const int* a = setup.a;
+  __m128i edge0 = _mm_add_epi32(_mm_set1_epi32(e0),
+      _mm_set_epi32(3 * a[0], 2 * a[0], a[0], 0));
+  __m128i edge1 = _mm_add_epi32(_mm_set1_epi32(e1),
+      _mm_set_epi32(3 * a[1], 2 * a[1], a[1], 0));
+  __m128i edge2 = _mm_add_epi32(_mm_set1_epi32(e2),
+      _mm_set_epi32(3 * a[2], 2 * a[2], a[2], 0));
+  const __m128i step0 = _mm_set1_epi32(4 * a[0]);
+  const __m128i step1 = _mm_set1_epi32(4 * a[1]);
+  const __m128i step2 = _mm_set1_epi32(4 * a[2]);
+
+  const __m128i minus_one = _mm_set1_epi32(-1);
+  const __m128 inv_area = _mm_set1_ps(setup.inv_area);
+  const __m128 z0 = _mm_set1_ps(setup.z);
+  const __m128 dz_beta = _mm_set1_ps(setup.dz_beta);
+  const __m128 dz_gamma = _mm_set1_ps(setup.dz_gamma);
+
+  float z_lanes[4];
+  float alpha_lanes[4];
+  float beta_lanes[4];
+  float gamma_lanes[4];
+
+  int num_fragments = 0;
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i inside = _mm_cmpgt_epi32(
+        _mm_or_si128(_mm_or_si128(edge0, edge1), edge2), minus_one);
+    if (_mm_movemask_epi8(inside) != 0) {
+      __m128 beta = _mm_mul_ps(_mm_cvtepi32_ps(edge1), inv_area);
+      __m128 gamma = _mm_mul_ps(_mm_cvtepi32_ps(edge2), inv_area);
+      __m128 z = _mm_add_ps(_mm_add_ps(z0, _mm_mul_ps(beta, dz_beta)),
+          _mm_mul_ps(gamma, dz_gamma));
+
+      __m128 old_depth = _mm_loadu_ps(depth + i);
+      __m128 pass = _mm_andnot_ps(_mm_cmpgt_ps(old_depth, z),
+          _mm_castsi128_ps(inside));
+      int mask = _mm_movemask_ps(pass);
+      if (mask != 0) {
+        _mm_storeu_ps(depth + i, _mm_or_ps(_mm_and_ps(pass, z),
+            _mm_andnot_ps(pass, old_depth)));
+
+        _mm_storeu_ps(z_lanes, z);
+        _mm_storeu_ps(alpha_lanes,
+            _mm_mul_ps(_mm_cvtepi32_ps(edge0), inv_area));
+        _mm_storeu_ps(beta_lanes, beta);
+        _mm_storeu_ps(gamma_lanes, gamma);
+        num_fragments += EmitFragments(x + i, mask, z_lanes, alpha_lanes,
+            beta_lanes, gamma_lanes, fragments + num_fragments);
+      }
+    }
+
+    edge0 = _mm_add_epi32(edge0, step0);
+    edge1 = _mm_add_epi32(edge1, step1);
+    edge2 = _mm_add_epi32(edge2, step2);
+  }
+
+  // Finish off any pixels that do not fill a whole vector.
+  return num_fragments + RasterizeSpanScalar(setup, x + i, count - i,
+      e0 + i * a[0], e1 + i * a[1], e2 + i * a[2], depth + i,
+      fragments + num_fragments);
+}
+
+//! As RasterizeSpanSse2(), but works on eight pixels at a time.
+__attribute__((target("avx2")))
+int RasterizeSpanAvx2(const TriangleSetup& setup, int x, int count,
+    int e0, int e1, int e2, float* depth, Fragment* fragments) {
+  const int* a = setup.a;
+  const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  __m256i edge0 = _mm256_add_epi32(_mm256_set1_epi32(e0),
+      _mm256_mullo_epi32(lanes, _mm256_set1_epi32(a[0])));
+  __m256i edge1 = _mm256_add_epi32(_mm256_set1_epi32(e1),
+      _mm256_mullo_epi32(lanes, _mm256_set1_epi32(a[1])));
+  __m256i edge2 = _mm256_add_epi32(_mm256_set1_epi32(e2),
+      _mm256_mullo_epi32(lanes, _mm256_set1_epi32(a[2])));
+  const __m256i step0 = _mm256_set1_epi32(8 * a[0]);
+  const __m256i step1 = _mm256_set1_epi32(8 * a[1]);
+  const __m256i step2 = _mm256_set1_epi32(8 * a[2]);
+
+  const __m256i minus_one = _mm256_set1_epi32(-1);
+  const __m256 inv_area = _mm256_set1_ps(setup.inv_area);
+  const __m256 z0 = _mm256_set1_ps(setup.z);
+  const __m256 dz_beta = _mm256_set1_ps(setup.dz_beta);
+  const __m256 dz_gamma = _mm256_set1_ps(setup.dz_gamma);
+
+  float z_lanes[8];
+  float alpha_lanes[8];
+  float beta_lanes[8];
+  float gamma_lanes[8];
+
+  int num_fragments = 0;
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i inside = _mm256_cmpgt_epi32(
+        _mm256_or_si256(_mm256_or_si256(edge0, edge1), edge2), minus_one);
+    if (!_mm256_testz_si256(inside, inside)) {
+      __m256 beta = _mm256_mul_ps(_mm256_cvtepi32_ps(edge1), inv_area);
+      __m256 gamma = _mm256_mul_ps(_mm256_cvtepi32_ps(edge2), inv_area);
+      __m256 z = _mm256_add_ps(
+          _mm256_add_ps(z0, _mm256_mul_ps(beta, dz_beta)),
+          _mm256_mul_ps(gamma, dz_gamma));
+
+      __m256 old_depth = _mm256_loadu_ps(depth + i);
+      __m256 pass = _mm256_andnot_ps(
+          _mm256_cmp_ps(old_depth, z, _CMP_GT_OQ),
+          _mm256_castsi256_ps(inside));
+      int mask = _mm256_movemask_ps(pass);
+      if (mask != 0) {
+        _mm256_storeu_ps(depth + i, _mm256_blendv_ps(old_depth, z, pass));
+
+        _mm256_storeu_ps(z_lanes, z);
+        _mm256_storeu_ps(alpha_lanes,
+            _mm256_mul_ps(_mm256_cvtepi32_ps(edge0), inv_area));
+        _mm256_storeu_ps(beta_lanes, beta);
+        _mm256_storeu_ps(gamma_lanes, gamma);
+        num_fragments += EmitFragments(x + i, mask, z_lanes, alpha_lanes,
+            beta_lanes, gamma_lanes, fragments + num_fragments);
+      }
+    }
+
+    edge0 = _mm256_add_epi32(edge0, step0);
+    edge1 = _mm256_add_epi32(edge1, step1);
+    edge2 = _mm256_add_epi32(edge2, step2);
+  }
+
+  // The remaining pixels are handled four at a time, then one at a time.
+  return num_fragments + RasterizeSpanSse2(setup, x + i, count - i,
+      e0 + i * a[0], e1 + i * a[1], e2 + i * a[2], depth + i,
+      fragments + num_fragments);
+}
+#endif  // RASTERIZER_X86_KERNELS
+
+SpanKernel& ActiveSpanKernel() {
+  static SpanKernel kernel = BestSpanKernel();
+  return kernel;
+}
+
+TriangleOrder& ActiveTriangleOrder() {
+  static TriangleOrder order = kSubmissionOrder;
+  return order;
+}
+
+//! The counts returned by CurrentGeometryStats(), added to by every thread.
+std::atomic<int> geometry_stats[kNumTriangleFates];
+}  // namespace
+
+SpanKernel BestSpanKernel() {
+  if (SpanKernelSupported(kAvx2Kernel)) {
+    return kAvx2Kernel;
+  }
+  if (SpanKernelSupported(kSse2Kernel)) {
+    return kSse2Kernel;
+  }
+  return kScalarKernel;
+}
+
+bool SpanKernelSupported(SpanKernel kernel) {
+  switch (kernel) {
+    case kScalarKernel:
+      return true;
+#ifdef RASTERIZER_X86_KERNELS
+    case kSse2Kernel:
+      return __builtin_cpu_supports("sse2");
+    case kAvx2Kernel:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+bool SetSpanKernel(SpanKernel kernel) {
+  if (!SpanKernelSupported(kernel)) {
+    return false;
+  }
+  ActiveSpanKernel() = kernel;
+  return true;
+}
+
+SpanKernel CurrentSpanKernel() {
+  return ActiveSpanKernel();
+}
+
+const char* SpanKernelName(SpanKernel kernel) {
+  switch (kernel) {
+    case kScalarKernel:
+      return "scalar";
+    case kSse2Kernel:
+      return "sse2";
+    case kAvx2Kernel:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+SpanFunction CurrentSpanFunction() {
+  switch (ActiveSpanKernel()) {
+#ifdef RASTERIZER_X86_KERNELS
+    case kSse2Kernel:
+      return RasterizeSpanSse2;
+    case kAvx2Kernel:
+      return RasterizeSpanAvx2;
+#endif
+    default:
+      return RasterizeSpanScalar;
+  }
+}
+
+TriangleFate SetupTriangle(Vertex p1, Vertex p2, Vertex p3,
+    const WindowInfo& window_info, CullMode cull, TriangleSetup& setup) {
+  // Reject triangles outside the window, or the guard band, before the
+  // coordinates are truncated to ints. A coordinate must be at least one
+  // pixel past the window's edge to truncate to a pixel outside it. NaNs
+  // fail every comparison, and are rejected too.
+  float min_x = std::min(p1[0], std::min(p2[0], p3[0]));
+  float max_x = std::max(p1[0], std::max(p2[0], p3[0]));
+  float min_y = std::min(p1[1], std::min(p2[1], p3[1]));
+  float max_y = std::max(p1[1], std::max(p2[1], p3[1]));
+  if (!(min_x < window_info.right + 1 && max_x > window_info.left - 1 &&
+        min_y < window_info.bottom + 1 && max_y > window_info.top - 1 &&
+        min_x >= -kGuardBand && max_x <= kGuardBand &&
+        min_y >= -kGuardBand && max_y <= kGuardBand)) {
+    return kTriangleRejected;
+  }
+
+  int x0 = p1[0];
+  int y0 = p1[1];
+
+  int x1 = p2[0];
+  int y1 = p2[1];
+
+  int x2 = p3[0];
+  int y2 = p3[1];
+
+  // The bounding box, clamped to the window.
+  setup.left = std::max(std::min(x0, std::min(x1, x2)), window_info.left);
+  setup.right = std::min(std::max(x0, std::max(x1, x2)), window_info.right);
+  setup.top = std::max(std::min(y0, std::min(y1, y2)), window_info.top);
+  setup.bottom = std::min(std::max(y0, std::max(y1, y2)), window_info.bottom);
+  if (setup.left > setup.right || setup.top > setup.bottom) {
+    return kTriangleRejected;
+  }
+
+  // alpha = f_12(x, y) / f_12(x0, y0), and similarly for beta and gamma.
+  SetEdge(0, x1, y1, x2, y2, setup);
+  SetEdge(1, x2, y2, x0, y0, setup);
+  SetEdge(2, x0, y0, x1, y1, setup);
+
+  // All three denominators are the doubled, signed area of the triangle.
+  int area = setup.a[0] * x0 + setup.b[0] * y0 + setup.c[0];
+  if (area == 0) {
+    return kTriangleRejected;
+  }
+
+  // Flip the edges of clockwise triangles, unless they are culled, so that
+  // the inside of the triangle is always where the edge functions are
+  // non-negative.
+  if (area < 0) {
+    if (cull == kCullBack) {
+      return kTriangleCulled;
+    }
+    area = -area;
+    for (int i = 0; i < 3; i++) {
+      setup.a[i] = -setup.a[i];
+      setup.b[i] = -setup.b[i];
+      setup.c[i] = -setup.c[i];
+    }
+  }
+  setup.inv_area = 1.0f / area;
+
+  setup.z = p1[2];
+  setup.dz_beta = p2[2] - p1[2];
+  setup.dz_gamma = p3[2] - p1[2];
+  setup.clipped = false;
+
+  return kTriangleDrawn;
+}
+
+DepthRange::DepthRange(const TriangleSetup& setup)
+    : left_(setup.left),
+      top_(setup.top) {
+  // The plane is worked out in double precision, as the barycentric
+  // coordinates at the corners of the bounding box can be far from [0, 1].
+  const double inv_area = setup.inv_area;
+  const double beta = (static_cast<double>(setup.a[1]) * left_ +
+      static_cast<double>(setup.b[1]) * top_ + setup.c[1]) * inv_area;
+  const double gamma = (static_cast<double>(setup.a[2]) * left_ +
+      static_cast<double>(setup.b[2]) * top_ + setup.c[2]) * inv_area;
+  z_ = setup.z + beta * setup.dz_beta + gamma * setup.dz_gamma;
+  dz_dx_ = (setup.a[1] * static_cast<double>(setup.dz_beta) +
+      setup.a[2] * static_cast<double>(setup.dz_gamma)) * inv_area;
+  dz_dy_ = (setup.b[1] * static_cast<double>(setup.dz_beta) +
+      setup.b[2] * static_cast<double>(setup.dz_gamma)) * inv_area;
+
+  // No pixel lies beyond the triangle's vertices.
+  const double z0 = setup.z;
+  const double z1 = z0 + setup.dz_beta;
+  const double z2 = z0 + setup.dz_gamma;
+
+  // The span kernels' rounding errors are a few units in the last place of
+  // the largest term in the depth.
+  slack_ = 1e-5 * (std::fabs(z0) + std::fabs(setup.dz_beta) +
+      std::fabs(setup.dz_gamma));
+  nearest_ = std::max(z0, std::max(z1, z2)) + slack_;
+  farthest_ = std::min(z0, std::min(z1, z2)) - slack_;
+}
+
+void SetTriangleOrder(TriangleOrder order) {
+  ActiveTriangleOrder() = order;
+}
+
+TriangleOrder CurrentTriangleOrder() {
+  return ActiveTriangleOrder();
+}
+
+void SortFrontToBack(std::vector<TriangleSetup>& triangles) {
+  // Larger depths are closer.
+  std::vector<std::pair<float, int> > keys(triangles.size());
+  for (size_t i = 0; i < triangles.size(); i++) {
+    const TriangleSetup& setup = triangles[i];
+    keys[i].first = -std::max(setup.z, std::max(setup.z + setup.dz_beta,
+        setup.z + setup.dz_gamma));
+    keys[i].second = i;
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<TriangleSetup> sorted(triangles.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    sorted[i] = triangles[keys[i].second];
+  }
+  triangles.swap(sorted);
+}
+
+GeometryStats CurrentGeometryStats() {
+  GeometryStats stats;
+  for (int i = 0; i < kNumTriangleFates; i++) {
+    stats.triangles[i] = geometry_stats[i].load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+void ResetGeometryStats() {
+  for (int i = 0; i < kNumTriangleFates; i++) {
+    geometry_stats[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void AddGeometryStats(const GeometryStats& stats) {
+  for (int i = 0; i < kNumTriangleFates; i++) {
+    geometry_stats[i].fetch_add(stats.triangles[i], std::memory_order_relaxed);
+  }
+}
+
+const int (*SamplePattern(int samples))[2] {
+  static const int kTwoSamples[2][2] = { { 4, 4 }, { -4, -4 } };
+  static const int kFourSamples[4][2] = {
+    { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 }
+  };
+  static const int kEightSamples[8][2] = {
+    { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 },
+    { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 }
+  };
+  switch (samples) {
+    case 2:
+      return kTwoSamples;
+    case 4:
+      return kFourSamples;
+    default:
+      return kEightSamples;
+  }
+}
+
+TileBins::TileBins()
+    : window_info_(0, -1, 0, -1),
+      tiles_x_(0),
+      tiles_y_(0) {
+}
+
+void TileBins::Bin(const std::vector<TriangleSetup>& triangles,
+    const WindowInfo& window_info) {
+  window_info_ = window_info;
+  tiles_x_ = (window_info.right - window_info.left + kTileSize) / kTileSize;
+  tiles_y_ = (window_info.bottom - window_info.top + kTileSize) / kTileSize;
+
+  bins_.resize(num_tiles());
+  for (size_t i = 0; i < bins_.size(); i++) {
+    bins_[i].clear();
+  }
+
+  for (size_t i = 0; i < triangles.size(); i++) {
+    const TriangleSetup& setup = triangles[i];
+    int first_x = (setup.left - window_info.left) / kTileSize;
+    int last_x = (setup.right - window_info.left) / kTileSize;
+    int first_y = (setup.top - window_info.top) / kTileSize;
+    int last_y = (setup.bottom - window_info.top) / kTileSize;
+
+    for (int tile_y = first_y; tile_y <= last_y; tile_y++) {
+      for (int tile_x = first_x; tile_x <= last_x; tile_x++) {
+        bins_[tile_y * tiles_x_ + tile_x].push_back(i);
+      }
+    }
+  }
+}
+
+WindowInfo TileBins::tile_bounds(int tile) const {
+  int left = window_info_.left + (tile % tiles_x_) * kTileSize;
+  int top = window_info_.top + (tile / tiles_x_) * kTileSize;
+  return WindowInfo(left, std::min(left + kTileSize - 1, window_info_.right),
+      top, std::min(top + kTileSize - 1, window_info_.bottom));
+}
+
+namespace {
+//! The bins that are not borrowed by a PooledTileBins. There are never more
+//! than the deepest nesting of RasterizeInTiles() calls on every thread.
+std::mutex tile_bins_mutex;
+std::vector<std::unique_ptr<TileBins> > free_tile_bins;
+}  // namespace
+
+PooledTileBins::PooledTileBins() {
+  {
+    std::lock_guard<std::mutex> lock(tile_bins_mutex);
+    if (!free_tile_bins.empty()) {
+      bins_ = free_tile_bins.back().release();
+      free_tile_bins.pop_back();
+      return;
+    }
+  }
+  bins_ = new TileBins();
+}
+
+PooledTileBins::~PooledTileBins() {
+  std::lock_guard<std::mutex> lock(tile_bins_mutex);
+  free_tile_bins.push_back(std::unique_ptr<TileBins>(bins_));
+}
+}  // namespace computer_graphics
@@ -0,0 +1,755 @@
+//! \author Stephen McGruer
+
+// Triangle setup and rasterization.
+
+#ifndef SRC_SHADING_RASTERIZER_H_
+#define SRC_SHADING_RASTERIZER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../depth_buffer.h"
+#include "../framebuffer.h"
+#include "../teapot_utils.h"
+#include "../job_system.h"
+#include "../vertex.h"
+
+namespace computer_graphics {
+
+//! \struct TriangleSetup
+//! \brief The per-triangle state needed to rasterize a projected triangle.
+//!
+//! Each edge function e_i(x, y) = a[i] * x + b[i] * y + c[i] is zero along
+//! the edge opposite vertex i, and is scaled so that it is non-negative
+//! inside the triangle. Dividing by the triangle's (doubled) area gives the
+//! barycentric coordinates: alpha = e_0 * inv_area, and so on.
+//!
+//! The vertex coordinates are truncated to whole pixels before the edge
+//! functions are calculated, so the edge functions can be stepped exactly
+//! from pixel to pixel with integer additions.
+struct TriangleSetup {
+  //! Identifies the triangle to the fragment callback of
+  //! RasterizeTriangles(). Set by the caller.
+  int id;
+
+  int a[3];
+  int b[3];
+  int c[3];
+  float inv_area;
+
+  //! The depth at the first vertex, and its change towards the second and
+  //! third vertices. The depth at a pixel is
+  //! z + beta * dz_beta + gamma * dz_gamma.
+  float z;
+  float dz_beta;
+  float dz_gamma;
+
+  //! The bounding box of the triangle, clamped to the window.
+  int left;
+  int right;
+  int top;
+  int bottom;
+
+  //! True if this is one piece of a triangle that was clipped. Row i of
+  //! barycentrics then holds the coordinates of the piece's vertex i within
+  //! the whole triangle, which fragments are given their coordinates in.
+  bool clipped;
+  float barycentrics[3][3];
+};
+
+//! \brief Maps a fragment's barycentric coordinates within a piece of a
+//!        clipped triangle to the whole triangle.
+inline void UnclipBarycentrics(const TriangleSetup& setup, float& alpha,
+    float& beta, float& gamma) {
+  const float (*b)[3] = setup.barycentrics;
+  const float whole_alpha = alpha * b[0][0] + beta * b[1][0] + gamma * b[2][0];
+  const float whole_beta = alpha * b[0][1] + beta * b[1][1] + gamma * b[2][1];
+  gamma = alpha * b[0][2] + beta * b[1][2] + gamma * b[2][2];
+  alpha = whole_alpha;
+  beta = whole_beta;
+}
+
+//! Coordinates must lie within this distance of the window's origin for a
+//! triangle's edge functions to fit in an int.
+const float kGuardBand = 8192.0f;
+
+//! Which triangles the geometry stage drops for facing away from the viewer.
+enum CullMode {
+  kCullNone,
+  kCullBack,
+};
+
+//! What the geometry stage did with a triangle.
+enum TriangleFate {
+  kTriangleDrawn,     //!< Set up for rasterization as it was.
+  kTriangleClipped,   //!< Clipped, and the pieces left set up.
+  kTriangleCulled,    //!< Facing away from the viewer.
+  kTriangleRejected,  //!< Outside the view, or without any area.
+  kNumTriangleFates,
+};
+
+//! \brief Sets up a triangle in window coordinates for rasterization.
+//!
+//! Back-facing triangles are those with a clockwise winding in window
+//! coordinates, whose outward normals point away from the viewer; they are
+//! culled if cull is kCullBack. Triangles that have no area, or lie outside
+//! the window, are rejected. So are triangles with a vertex outside the
+//! kGuardBand, whose edge functions could overflow; projected triangles
+//! should be clipped to it with SetupPerspectiveTriangle() instead.
+//!
+//! The setup is only filled in if the triangle is drawn.
+TriangleFate SetupTriangle(Vertex p1, Vertex p2, Vertex p3,
+    const WindowInfo& window_info, CullMode cull, TriangleSetup& setup);
+
+//! The most pieces that clipping can cut a triangle into.
+const int kMaxClippedTriangles = 6;
+
+//! \struct ClippedTriangle
+//! \brief The setups that one triangle is rasterized as: none if it is
+//!        culled or rejected, one if it is drawn, and one per piece left if
+//!        it is clipped.
+struct ClippedTriangle {
+  int count;
+  TriangleSetup setups[kMaxClippedTriangles];
+};
+
+//! \brief Sets up a triangle in window coordinates as the only setup of a
+//!        ClippedTriangle. See SetupTriangle().
+inline TriangleFate SetupTriangle(Vertex p1, Vertex p2, Vertex p3,
+    const WindowInfo& window_info, CullMode cull, ClippedTriangle& clipped) {
+  TriangleFate fate = SetupTriangle(p1, p2, p3, window_info, cull,
+      clipped.setups[0]);
+  clipped.count = (fate == kTriangleDrawn) ? 1 : 0;
+  return fate;
+}
+
+//! \brief Gives a set up triangle the same depth, z, at every pixel.
+inline void SetConstantDepth(float z, TriangleSetup& setup) {
+  setup.z = z;
+  setup.dz_beta = 0.0f;
+  setup.dz_gamma = 0.0f;
+}
+
+//! \brief Gives every piece of a clipped triangle the same depth, z, at
+//!        every pixel.
+inline void SetConstantDepth(float z, ClippedTriangle& clipped) {
+  for (int i = 0; i < clipped.count; i++) {
+    SetConstantDepth(z, clipped.setups[i]);
+  }
+}
+
+//! \struct GeometryStats
+//! \brief Counts the triangles given each TriangleFate by SetupTriangles().
+struct GeometryStats {
+  GeometryStats() {
+    std::fill(triangles, triangles + kNumTriangleFates, 0);
+  }
+
+  int triangles[kNumTriangleFates];
+};
+
+//! \brief Returns the triangles counted by SetupTriangles() since the last
+//!        ResetGeometryStats().
+GeometryStats CurrentGeometryStats();
+
+//! Resets the counts returned by CurrentGeometryStats().
+void ResetGeometryStats();
+
+//! Adds to the counts returned by CurrentGeometryStats(). Thread-safe.
+void AddGeometryStats(const GeometryStats& stats);
+
+//! \struct Fragment
+//! \brief A pixel of a triangle that has passed the depth test.
+struct Fragment {
+  int x;
+  float z;
+  float alpha;
+  float beta;
+  float gamma;
+};
+
+//! The most pixels that a span function is asked to rasterize at once.
+const int kMaxSpanLength = 64;
+
+//! \brief Rasterizes a horizontal span of a triangle.
+//!
+//! Handles the count pixels starting at x, where e0, e1 and e2 are the edge
+//! functions at x and depth points at the depth buffer entry for x. Each
+//! pixel that is inside the triangle and at least as close as the depth
+//! buffer has its depth written, and is added to fragments in order of
+//! increasing x. Returns the number of fragments.
+typedef int (*SpanFunction)(const TriangleSetup& setup, int x, int count,
+    int e0, int e1, int e2, float* depth, Fragment* fragments);
+
+//! The implementations of SpanFunction.
+enum SpanKernel {
+  kScalarKernel,
+  kSse2Kernel,
+  kAvx2Kernel,
+};
+
+//! Returns the fastest span kernel that the CPU supports.
+SpanKernel BestSpanKernel();
+
+//! Returns true if the span kernel can run on this CPU.
+bool SpanKernelSupported(SpanKernel kernel);
+
+//! \brief Sets the span kernel used by RasterizeTriangle().
+//!
+//! Defaults to BestSpanKernel(). Returns false, and leaves the kernel
+//! unchanged, if the kernel is not supported.
+bool SetSpanKernel(SpanKernel kernel);
+
+//! Returns the span kernel used by RasterizeTriangle().
+SpanKernel CurrentSpanKernel();
+
+//! Returns the human-readable name of a span kernel.
+const char* SpanKernelName(SpanKernel kernel);
+
+//! Returns the span function for the current span kernel.
+SpanFunction CurrentSpanFunction();
+
+//! \class DepthRange
+//! \brief Finds the range of depths that RasterizeTriangle() can give the
+//!        pixels of a triangle within rectangles of the window.
+//!
+//! The ranges are widened a little, so that they also hold the depths that
+//! the span kernels round to.
+class DepthRange {
+  public:
+    explicit DepthRange(const TriangleSetup& setup);
+
+    //! Finds the range of depths of the triangle's pixels within bounds.
+    inline void Find(const WindowInfo& bounds, float& nearest,
+        float& farthest) const {
+      // The depth is linear in x and y, so it is largest and smallest at
+      // two opposite corners.
+      const double corner = z_ + dz_dx_ * (bounds.left - left_) +
+          dz_dy_ * (bounds.top - top_);
+      const double across = dz_dx_ * (bounds.right - bounds.left);
+      const double down = dz_dy_ * (bounds.bottom - bounds.top);
+      nearest = std::min(nearest_,
+          corner + std::max(across, 0.0) + std::max(down, 0.0) + slack_);
+      farthest = std::max(farthest_,
+          corner + std::min(across, 0.0) + std::min(down, 0.0) - slack_);
+    }
+
+  private:
+    //! The depth at (left_, top_), and its change per pixel in x and y.
+    int left_;
+    int top_;
+    double z_;
+    double dz_dx_;
+    double dz_dy_;
+
+    //! The range of depths over the whole triangle.
+    double nearest_;
+    double farthest_;
+
+    //! How far the range is widened.
+    double slack_;
+};
+
+//! Returns true if every pixel within bounds is inside the triangle.
+inline bool TriangleCovers(const TriangleSetup& setup,
+    const WindowInfo& bounds) {
+  const int xs[2] = { bounds.left, bounds.right };
+  const int ys[2] = { bounds.top, bounds.bottom };
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      const int e0 = setup.a[0] * xs[i] + setup.b[0] * ys[j] + setup.c[0];
+      const int e1 = setup.a[1] * xs[i] + setup.b[1] * ys[j] + setup.c[1];
+      const int e2 = setup.a[2] * xs[i] + setup.b[2] * ys[j] + setup.c[2];
+      if ((e0 | e1 | e2) < 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//! \brief Returns false if the triangle is hidden everywhere in a block of
+//!        the depth buffer, going by the block's bound.
+//!
+//! A stale bound is only brought up to date if the triangle covers the
+//! whole block, as only then does rejecting it save much work.
+inline bool BlockMightBeVisible(const TriangleSetup& setup,
+    const DepthRange& range, int column, int row,
+    DepthBuffer& depth_buffer) {
+  const WindowInfo block = depth_buffer.block_bounds(column, row);
+  const WindowInfo bounds(std::max(block.left, setup.left),
+      std::min(block.right, setup.right), std::max(block.top, setup.top),
+      std::min(block.bottom, setup.bottom));
+  float nearest;
+  float farthest;
+  range.Find(bounds, nearest, farthest);
+  if (nearest < depth_buffer.block_depth(column, row)) {
+    return false;
+  }
+  if (depth_buffer.block_stale(column, row) &&
+      TriangleCovers(setup, block)) {
+    return !(nearest < depth_buffer.UpdateBlockDepth(column, row));
+  }
+  return true;
+}
+
+//! \brief Updates the bound of a block of the depth buffer after the
+//!        triangle has been rasterized over it.
+inline void UpdateBlockDepth(const TriangleSetup& setup,
+    const DepthRange& range, int column, int row,
+    DepthBuffer& depth_buffer) {
+  depth_buffer.MarkBlockStale(column, row);
+
+  // Every pixel of a covered block is now at least as close as the
+  // triangle.
+  const WindowInfo block = depth_buffer.block_bounds(column, row);
+  if (block.left >= setup.left && block.right <= setup.right &&
+      block.top >= setup.top && block.bottom <= setup.bottom &&
+      TriangleCovers(setup, block)) {
+    float nearest;
+    float farthest;
+    range.Find(block, nearest, farthest);
+    depth_buffer.RaiseBlockDepth(column, row, farthest);
+  }
+}
+
+//! \brief Rasterizes the part of a triangle that lies within bounds, which
+//!        must be within its bounding box. See RasterizeTriangle().
+template <typename FragmentFunction>
+void RasterizeRectangle(const TriangleSetup& setup, const WindowInfo& bounds,
+    SpanFunction rasterize_span, DepthBuffer& depth_buffer,
+    FragmentFunction shade) {
+  const int left = bounds.left;
+  const int depth_left = depth_buffer.window_info().left;
+  int row0 = setup.a[0] * left + setup.b[0] * bounds.top + setup.c[0];
+  int row1 = setup.a[1] * left + setup.b[1] * bounds.top + setup.c[1];
+  int row2 = setup.a[2] * left + setup.b[2] * bounds.top + setup.c[2];
+
+  Fragment fragments[kMaxSpanLength];
+  for (int y = bounds.top; y <= bounds.bottom; y++) {
+    float* depth_row = depth_buffer.row(y);
+    int e0 = row0;
+    int e1 = row1;
+    int e2 = row2;
+
+    for (int x = left; x <= bounds.right; x += kMaxSpanLength) {
+      int count = std::min(kMaxSpanLength, bounds.right - x + 1);
+      int num_fragments = rasterize_span(setup, x, count, e0, e1, e2,
+          depth_row + (x - depth_left), fragments);
+      for (int i = 0; i < num_fragments; i++) {
+        const Fragment& fragment = fragments[i];
+        float alpha = fragment.alpha;
+        float beta = fragment.beta;
+        float gamma = fragment.gamma;
+        if (setup.clipped) {
+          UnclipBarycentrics(setup, alpha, beta, gamma);
+        }
+        shade(fragment.x, y, fragment.z, alpha, beta, gamma);
+      }
+
+      e0 += setup.a[0] * count;
+      e1 += setup.a[1] * count;
+      e2 += setup.a[2] * count;
+    }
+
+    row0 += setup.b[0];
+    row1 += setup.b[1];
+    row2 += setup.b[2];
+  }
+}
+
+//! \brief Rasterizes a triangle against a depth buffer.
+//!
+//! Visits each pixel inside the triangle in turn, and depth tests it. For
+//! each pixel that is at least as close as the depth buffer, the depth is
+//! written and then shade(x, y, z, alpha, beta, gamma) is called with the
+//! pixel's depth and barycentric coordinates. For a piece of a clipped
+//! triangle, these are the coordinates within the whole triangle.
+//!
+//! The bounding box is walked a row of depth buffer blocks at a time, and
+//! blocks whose bound shows that the triangle is hidden are skipped. The
+//! rest are handed to the current span kernel in runs of up to
+//! kMaxSpanLength pixels per row; the fragments are shaded once the whole
+//! run has been depth tested.
+template <typename FragmentFunction>
+void RasterizeTriangle(const TriangleSetup& setup, DepthBuffer& depth_buffer,
+    FragmentFunction shade) {
+  const SpanFunction rasterize_span = CurrentSpanFunction();
+  const DepthRange range(setup);
+  const int first_column = depth_buffer.BlockColumn(setup.left);
+  const int last_column = depth_buffer.BlockColumn(setup.right);
+  const int first_row = depth_buffer.BlockRow(setup.top);
+  const int last_row = depth_buffer.BlockRow(setup.bottom);
+
+  for (int row = first_row; row <= last_row; row++) {
+    int column = first_column;
+    while (column <= last_column) {
+      if (!BlockMightBeVisible(setup, range, column, row, depth_buffer)) {
+        column++;
+        continue;
+      }
+
+      // Rasterize the run of blocks that the triangle might be seen in.
+      int end = column + 1;
+      while (end <= last_column &&
+          BlockMightBeVisible(setup, range, end, row, depth_buffer)) {
+        end++;
+      }
+      const WindowInfo first = depth_buffer.block_bounds(column, row);
+      const WindowInfo last = depth_buffer.block_bounds(end - 1, row);
+      const WindowInfo bounds(std::max(first.left, setup.left),
+          std::min(last.right, setup.right), std::max(first.top, setup.top),
+          std::min(first.bottom, setup.bottom));
+      RasterizeRectangle(setup, bounds, rasterize_span, depth_buffer, shade);
+
+      for (; column < end; column++) {
+        UpdateBlockDepth(setup, range, column, row, depth_buffer);
+      }
+    }
+  }
+}
+
+//! The width and height of the screen tiles used by RasterizeTriangles().
+//! Each tile holds whole depth buffer blocks, so that tiles never share a
+//! block's bound.
+const int kTileSize = 32;
+static_assert(kTileSize % DepthBuffer::kBlockSize == 0,
+    "Tiles must be made of whole depth buffer blocks");
+
+//! \class TileBins
+//! \brief Sorts triangles into the screen tiles that their bounding boxes
+//!        overlap.
+//!
+//! Within each tile, triangles are kept in the order they were given in.
+class TileBins {
+  public:
+    TileBins();
+
+    //! Bins the triangles into kTileSize square tiles covering the window.
+    void Bin(const std::vector<TriangleSetup>& triangles,
+        const WindowInfo& window_info);
+
+    inline int num_tiles() const { return tiles_x_ * tiles_y_; }
+
+    //! Returns the area of the window covered by a tile.
+    WindowInfo tile_bounds(int tile) const;
+
+    //! Returns the indices of the triangles overlapping a tile.
+    inline const std::vector<int>& triangles(int tile) const {
+      return bins_[tile];
+    }
+
+  private:
+    WindowInfo window_info_;
+    int tiles_x_;
+    int tiles_y_;
+
+    //! Kept between frames so that the bins do not need reallocating.
+    std::vector<std::vector<int> > bins_;
+};
+
+//! \class PooledTileBins
+//! \brief Borrows a TileBins from a shared pool for as long as it lives.
+//!
+//! Each RasterizeInTiles() call bins into its own TileBins. A thread that
+//! waits on its tile jobs may run another job that rasterizes in the
+//! meantime, so the bins cannot belong to the thread. Returned bins keep
+//! their allocations for the next call.
+class PooledTileBins {
+  public:
+    PooledTileBins();
+    ~PooledTileBins();
+
+    inline TileBins& bins() { return *bins_; }
+
+  private:
+    PooledTileBins(const PooledTileBins&);
+    PooledTileBins& operator=(const PooledTileBins&);
+
+    TileBins* bins_;
+};
+
+//! \brief Shrinks a triangle's bounding box to lie within bounds.
+//!
+//! Returns false if nothing of the bounding box is left.
+inline bool ClipBoundingBox(const WindowInfo& bounds, TriangleSetup& setup) {
+  setup.left = std::max(setup.left, bounds.left);
+  setup.right = std::min(setup.right, bounds.right);
+  setup.top = std::max(setup.top, bounds.top);
+  setup.bottom = std::min(setup.bottom, bounds.bottom);
+  return setup.left <= setup.right && setup.top <= setup.bottom;
+}
+
+//! The orders that SetupTriangles() can leave triangles in.
+enum TriangleOrder {
+  kSubmissionOrder,  //!< The order the triangles were given in.
+  kFrontToBack,      //!< Nearest first, so that more are hidden.
+};
+
+//! \brief Sets the order that SetupTriangles() leaves triangles in.
+//!
+//! Defaults to kSubmissionOrder. Drawing front to back lets the depth buffer
+//! blocks reject more of each triangle, but where triangles meet at exactly
+//! the same depth, a different one may end up being drawn.
+void SetTriangleOrder(TriangleOrder order);
+
+//! Returns the order that SetupTriangles() leaves triangles in.
+TriangleOrder CurrentTriangleOrder();
+
+//! \brief Stably sorts set up triangles by their nearest depth, nearest
+//!        first.
+void SortFrontToBack(std::vector<TriangleSetup>& triangles);
+
+//! \brief Sets up count triangles in parallel on the shared job system.
+//!
+//! setup_triangle(i, clipped) is called for each triangle, fills in the
+//! setups of its ClippedTriangle, and returns its TriangleFate. The setups
+//! are stored in their triangles' original order, or sorted front to back
+//! if that is the CurrentTriangleOrder(), with each triangle's index as
+//! their id, and the fates are added to the GeometryStats.
+template <typename SetupFunction>
+void SetupTriangles(int count, std::vector<TriangleSetup>& triangles,
+    SetupFunction setup_triangle) {
+  // Each triangle's first setup goes in its own slot, and any further pieces
+  // of clipped triangles are collected separately.
+  triangles.resize(count);
+  std::vector<char> fates(count);
+  std::vector<TriangleSetup> pieces;
+  std::mutex pieces_mutex;
+  Jobs().ParallelFor(count, [&](int i) {
+    ClippedTriangle clipped;
+    clipped.count = 0;
+    fates[i] = setup_triangle(i, clipped);
+    for (int j = 0; j < clipped.count; j++) {
+      clipped.setups[j].id = i;
+    }
+    if (clipped.count > 0) {
+      triangles[i] = clipped.setups[0];
+    }
+    if (clipped.count > 1) {
+      std::lock_guard<std::mutex> lock(pieces_mutex);
+      pieces.insert(pieces.end(), clipped.setups + 1,
+          clipped.setups + clipped.count);
+    }
+  });
+
+  GeometryStats stats;
+  for (int i = 0; i < count; i++) {
+    stats.triangles[static_cast<int>(fates[i])]++;
+  }
+  AddGeometryStats(stats);
+
+  if (pieces.empty()) {
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+      if (fates[i] == kTriangleDrawn || fates[i] == kTriangleClipped) {
+        triangles[kept++] = triangles[i];
+      }
+    }
+    triangles.resize(kept);
+  } else {
+    // Each triangle's pieces were added together, so sorting by id keeps
+    // them in order.
+    std::stable_sort(pieces.begin(), pieces.end(),
+        [](const TriangleSetup& a, const TriangleSetup& b) {
+      return a.id < b.id;
+    });
+    std::vector<TriangleSetup> kept;
+    kept.reserve(count + pieces.size());
+    size_t next_piece = 0;
+    for (int i = 0; i < count; i++) {
+      if (fates[i] == kTriangleDrawn || fates[i] == kTriangleClipped) {
+        kept.push_back(triangles[i]);
+        while (next_piece < pieces.size() && pieces[next_piece].id == i) {
+          kept.push_back(pieces[next_piece++]);
+        }
+      }
+    }
+    triangles.swap(kept);
+  }
+
+  if (CurrentTriangleOrder() == kFrontToBack) {
+    SortFrontToBack(triangles);
+  }
+}
+
+//! \brief Calls rasterize(setup) for each triangle in turn, where each call
+//!        only touches the pixels within the setup's bounding box.
+//!
+//! When the shared job system has more than one thread, the triangles are
+//! first binned into screen tiles, and the tiles are then rasterized in
+//! parallel. Each call is then given a copy of the setup with its bounding
+//! box clipped to the tile. Each tile only touches its own pixels and keeps
+//! its triangles in their original order, so the result is the same as
+//! rasterizing on one thread.
+template <typename TriangleFunction>
+void RasterizeInTiles(const std::vector<TriangleSetup>& triangles,
+    const WindowInfo& window_info, TriangleFunction rasterize) {
+  JobSystem& jobs = Jobs();
+  if (jobs.num_threads() == 1) {
+    for (size_t i = 0; i < triangles.size(); i++) {
+      rasterize(triangles[i]);
+    }
+    return;
+  }
+
+  PooledTileBins pooled_bins;
+  TileBins& bins = pooled_bins.bins();
+  bins.Bin(triangles, window_info);
+  jobs.ParallelFor(bins.num_tiles(), [&](int tile) {
+    const WindowInfo bounds = bins.tile_bounds(tile);
+    const std::vector<int>& tile_triangles = bins.triangles(tile);
+    for (size_t i = 0; i < tile_triangles.size(); i++) {
+      TriangleSetup setup = triangles[tile_triangles[i]];
+      if (ClipBoundingBox(bounds, setup)) {
+        rasterize(setup);
+      }
+    }
+  });
+}
+
+//! \brief Rasterizes a list of triangles against a depth buffer.
+//!
+//! Equivalent to calling RasterizeTriangle() on each triangle in order, but
+//! calls shade(id, x, y, z, alpha, beta, gamma) with the id of the triangle
+//! that each fragment belongs to. The triangles are spread across threads
+//! by RasterizeInTiles(), so the shade function must be safe to call from
+//! several threads at once for different pixels.
+template <typename FragmentFunction>
+void RasterizeTriangles(const std::vector<TriangleSetup>& triangles,
+    DepthBuffer& depth_buffer, FragmentFunction shade) {
+  RasterizeInTiles(triangles, depth_buffer.window_info(),
+      [&](const TriangleSetup& setup) {
+    const int id = setup.id;
+    RasterizeTriangle(setup, depth_buffer,
+        [&](int x, int y, float z, float alpha, float beta, float gamma) {
+      shade(id, x, y, z, alpha, beta, gamma);
+    });
+  });
+}
+
+//! The most samples per pixel that multisampling takes.
+const int kMaxSamples = 8;
+
+//! \brief Returns the positions of the samples in a pixel, for
+//!        multisampling with 2, 4 or 8 samples.
+//!
+//! The positions are x and y offsets from the pixel's centre in sixteenths
+//! of a pixel. They are the standard Direct3D patterns, which spread the
+//! samples over as many rows and columns as possible.
+const int (*SamplePattern(int samples))[2];
+
+//! \brief Rasterizes a triangle against the samples of a multisampled
+//!        framebuffer.
+//!
+//! Each sample inside the triangle is depth tested. If any of a pixel's
+//! samples are at least as close as their depths, their depths are written,
+//! shade(x, y, z, alpha, beta, gamma) is called once with the depth and
+//! barycentric coordinates at the pixel's centre, and the colour that it
+//! sets is copied to those samples. If the centre lies outside the
+//! triangle, the first of those samples is shaded instead.
+template <typename FragmentFunction>
+void RasterizeTriangleMultisampled(const TriangleSetup& setup,
+    Framebuffer& framebuffer, FragmentFunction shade) {
+  const int samples = framebuffer.samples();
+  const int (*pattern)[2] = SamplePattern(samples);
+
+  // The edge functions are worked in sixteenths of a pixel, which can
+  // overflow an int within the guard band.
+  int64_t offsets[kMaxSamples][3];
+  for (int i = 0; i < samples; i++) {
+    for (int j = 0; j < 3; j++) {
+      offsets[i][j] = static_cast<int64_t>(setup.a[j]) * pattern[i][0] +
+          static_cast<int64_t>(setup.b[j]) * pattern[i][1];
+    }
+  }
+  const float sample_inv_area = setup.inv_area / 16.0f;
+
+  for (int y = setup.top; y <= setup.bottom; y++) {
+    int e0 = setup.a[0] * setup.left + setup.b[0] * y + setup.c[0];
+    int e1 = setup.a[1] * setup.left + setup.b[1] * y + setup.c[1];
+    int e2 = setup.a[2] * setup.left + setup.b[2] * y + setup.c[2];
+
+    for (int x = setup.left; x <= setup.right; x++) {
+      float* depths = framebuffer.sample_depths(x, y);
+      int mask = 0;
+      for (int i = 0; i < samples; i++) {
+        const int64_t s0 = 16 * static_cast<int64_t>(e0) + offsets[i][0];
+        const int64_t s1 = 16 * static_cast<int64_t>(e1) + offsets[i][1];
+        const int64_t s2 = 16 * static_cast<int64_t>(e2) + offsets[i][2];
+        if ((s0 | s1 | s2) >= 0) {
+          const float z = setup.z + s1 * sample_inv_area * setup.dz_beta +
+              s2 * sample_inv_area * setup.dz_gamma;
+          if (!(depths[i] > z)) {
+            depths[i] = z;
+            mask |= 1 << i;
+          }
+        }
+      }
+
+      if (mask != 0) {
+        // Shade at the centre if it is inside the triangle, and otherwise
+        // at the first sample written, so that the coordinates of thin
+        // triangles are not extrapolated far outside them.
+        float alpha;
+        float beta;
+        float gamma;
+        if ((e0 | e1 | e2) >= 0) {
+          alpha = e0 * setup.inv_area;
+          beta = e1 * setup.inv_area;
+          gamma = e2 * setup.inv_area;
+        } else {
+          int i = 0;
+          while (!(mask & (1 << i))) {
+            i++;
+          }
+          alpha = (16 * static_cast<int64_t>(e0) + offsets[i][0]) *
+              sample_inv_area;
+          beta = (16 * static_cast<int64_t>(e1) + offsets[i][1]) *
+              sample_inv_area;
+          gamma = (16 * static_cast<int64_t>(e2) + offsets[i][2]) *
+              sample_inv_area;
+        }
+        const float z = setup.z + beta * setup.dz_beta +
+            gamma * setup.dz_gamma;
+        if (setup.clipped) {
+          UnclipBarycentrics(setup, alpha, beta, gamma);
+        }
+        shade(x, y, z, alpha, beta, gamma);
+        framebuffer.StoreSamples(x, y, mask);
+      }
+
+      e0 += setup.a[0];
+      e1 += setup.a[1];
+      e2 += setup.a[2];
+    }
+  }
+}
+
+//! \brief Rasterizes a list of triangles into a framebuffer.
+//!
+//! As the depth buffer version, against the framebuffer's depth plane, or
+//! its samples if it is multisampled. The shade function sets the colour of
+//! pixel (x, y) in the framebuffer.
+template <typename FragmentFunction>
+void RasterizeTriangles(const std::vector<TriangleSetup>& triangles,
+    Framebuffer& framebuffer, FragmentFunction shade) {
+  if (framebuffer.samples() == 1) {
+    RasterizeTriangles(triangles, framebuffer.depth_buffer(), shade);
+    return;
+  }
+
+  RasterizeInTiles(triangles, framebuffer.window_info(),
+      [&](const TriangleSetup& setup) {
+    const int id = setup.id;
+    RasterizeTriangleMultisampled(setup, framebuffer,
+        [&](int x, int y, float z, float alpha, float beta, float gamma) {
+      shade(id, x, y, z, alpha, beta, gamma);
+    });
+  });
+}
+}  // namespace computer_graphics
+
+#endif  // SRC_SHADING_RASTERIZER_H_
@@ -6,92 +6,94 @@ namespace computer_graphics {
 
 //! Uses a Phong/Gourard shading-like approach, in order to get
 //! nice z-interpolation for the z_buffer.
-void ShadingAlgorithm::RenderFloor(TriangleMesh the_floor, WindowInfo window_info,
+void ShadingAlgorithm::RenderFloor(TriangleMesh& the_floor, WindowInfo window_info,
     Vertex light_position, Vertex view_position,
-    std::vector<std::vector<float> >& z_buffer,
-    std::vector<std::vector<float> > shadow_buffer,
-    std::vector<Vertex>& points) {
+    const DepthBuffer* shadow_buffer, Framebuffer& framebuffer) {
+  std::vector<TriangleSetup> triangles;
+  SetupFloorTriangles(the_floor, window_info, triangles);
+
+  // Render the floor triangles.
+  DrawTriangles(triangles, framebuffer,
+      [&](int, int x, int y, float z, float, float, float) {
+    ShadeFloorPoint(x, y, z, light_position, shadow_buffer, framebuffer);
+  });
+}
+
+void ShadingAlgorithm::SetupFloorTriangles(TriangleMesh& the_floor,
+    WindowInfo window_info, std::vector<TriangleSetup>& triangles) {
+  // The floor is drawn from its world-space positions directly.
+  const VertexStream& positions = the_floor.positions();
+
+  SetupTriangles(the_floor.trigNum(), triangles,
+      [&](int i, ClippedTriangle& clipped) -> TriangleFate {
+    const Triangle& vertices = the_floor.triangle(i);
+    Vertex p1 = positions.Get(vertices[0]);
+    Vertex p2 = positions.Get(vertices[1]);
+    Vertex p3 = positions.Get(vertices[2]);
+
+    // Set up the triangle's edge functions and bounding box.
+    return SetupTriangle(p1, p2, p3, window_info, cull_mode(), clipped);
+  });
+}
+
+void ShadingAlgorithm::ShadeFloorPoint(int x, int y, float z,
+    Vertex light_position, const DepthBuffer* shadow_buffer,
+    Framebuffer& framebuffer) {
+  const WindowInfo& window_info = framebuffer.window_info();
   int window_width = std::abs(window_info.left) + std::abs(window_info.right);
   int window_height = std::abs(window_info.top) + std::abs(window_info.bottom);
 
-  for (int i = 0; i < the_floor.trigNum(); i++) {
-    std::vector<int> vertices;
-    the_floor.GetTriangleVerticesInt(i, vertices);
-    Vertex p1 = the_floor.v(vertices[0]);
-    Vertex p2 = the_floor.v(vertices[1]);
-    Vertex p3 = the_floor.v(vertices[2]);
-
-    // For efficiency, establish a bounding box for the triangle.
-    int left = clamp(std::min(p1[0], std::min(p2[0], p3[0])),
-        window_info.left, window_info.right);
-    int right = clamp(std::max(p1[0], std::max(p2[0], p3[0])),
-        window_info.left, window_info.right);
-    int top = clamp(std::min(p1[1], std::min(p2[1], p3[1])),
-        window_info.top, window_info.bottom);
-    int bottom = clamp(std::max(p1[1], std::max(p2[1], p3[1])),
-        window_info.top, window_info.bottom);
-
-    // Render the floor triangles.
-    for (int y = top; y <= bottom; y++) {
-      for (int x = left; x <= right; x++) {
-        if (!InTriangle(x, y, p1, p2, p3)) {
-          continue;
-        }
-        float alpha;
-        float beta;
-        float gamma;
-        CalculateBarycentricCoordinates(x, y, p1, p2, p3, alpha, beta, gamma);
-        float z = alpha * p1[2] + beta * p2[2] + gamma * p3[2];
-
-        if (z_buffer[x + window_width / 2][y + window_height / 2] > z) {
-          continue;
-        }
-        z_buffer[x + window_width / 2][y + window_height / 2] = z;
-
-        // Fit x,y to image-width/image-height
-        int fitted_x = ((float) (x + window_width / 2) / window_width) * floor_texture_->width;
-        int fitted_y = ((float) (y + window_height / 2) / window_height) * floor_texture_->height;
-
-        // The data is stored BGR not RGB.
-        std::vector<float> colours;
-        uchar *data;
-        data = (uchar *) floor_texture_->imageData;
-        if (!shadows_) {
-          colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 2] / 255.0f);
-          colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 1] / 255.0f);
-          colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 0] / 255.0f);
-        } else {
-          Vertex point(x, y, z);
-          Project(point, light_position, window_width, window_height);
-          float projX = point[0];
-          float projY = point[1];
-          float projZ = point[2];
-
-          if ((projX + window_width / 2) < 0 ||
-              (projX + window_width / 2) > shadow_buffer.size() ||
-              (projY + window_height / 2) < 0 ||
-              (projY + window_height / 2) > shadow_buffer[0].size() ||
-              shadow_buffer[projX + window_width / 2][projY + window_height / 2] <= projZ) {
-            // If the point is outside what the light can see, or if it is the
-            // closest thing the point can see, then it is lit.
-            colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 2] / 255.0f);
-            colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 1] / 255.0f);
-            colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 0] / 255.0f);
-          } else {
-            // The point is in shadow.
-            colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 2] / 255.0f - 0.5f);
-            colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 1] / 255.0f - 0.5f);
-            colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 0] / 255.0f - 0.5f);
-          }
-        }
-        clampf(colours[0], 0.0f, 1.0f);
-        clampf(colours[1], 0.0f, 1.0f);
-        clampf(colours[2], 0.0f, 1.0f);
-
-        points.push_back(Vertex(x, y, z, colours[0], colours[1], colours[2]));
-      }
+  // Fit x,y to image-width/image-height
+  int fitted_x = ((float) (x + window_width / 2) / window_width) * floor_texture_->width;
+  int fitted_y = ((float) (y + window_height / 2) / window_height) * floor_texture_->height;
+
+  // The data is stored BGR not RGB.
+  std::vector<float> colours;
+  uchar *data;
+  data = (uchar *) floor_texture_->imageData;
+  if (!shadows_ || shadow_buffer == NULL) {
+    colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 2] / 255.0f);
+    colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 1] / 255.0f);
+    colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 0] / 255.0f);
+  } else {
+    if (IsLit(x, y, z, light_position, *shadow_buffer, 0.0f)) {
+      colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 2] / 255.0f);
+      colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 1] / 255.0f);
+      colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 0] / 255.0f);
+    } else {
+      // The point is in shadow.
+      colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 2] / 255.0f - 0.5f);
+      colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 1] / 255.0f - 0.5f);
+      colours.push_back((float) data[fitted_y * floor_texture_->widthStep + fitted_x * floor_texture_->nChannels + 0] / 255.0f - 0.5f);
     }
   }
+  clampf(colours[0], 0.0f, 1.0f);
+  clampf(colours[1], 0.0f, 1.0f);
+  clampf(colours[2], 0.0f, 1.0f);
+
+  framebuffer.SetColour(x, y, colours[0], colours[1], colours[2]);
+}
+
+bool ShadingAlgorithm::IsLit(int x, int y, float z, Vertex light_position,
+    const DepthBuffer& shadow_buffer, float bias) {
+  const WindowInfo& window_info = shadow_buffer.window_info();
+  int window_width = std::abs(window_info.left) + std::abs(window_info.right);
+  int window_height = std::abs(window_info.top) + std::abs(window_info.bottom);
+
+  // Project the point to the light's viewpoint.
+  Vertex point(x, y, z);
+  Project(point, light_position, window_width, window_height);
+  float shadow_x = point[0] + window_width / 2;
+  float shadow_y = point[1] + window_height / 2;
+
+  // If the point is outside what the light can see, or if it is the
+  // closest thing the light can see, then it is lit.
+  if (shadow_x < 0 || shadow_x >= shadow_buffer.width() ||
+      shadow_y < 0 || shadow_y >= shadow_buffer.height()) {
+    return true;
+  }
+  return shadow_buffer.depth(window_info.left + static_cast<int>(shadow_x),
+      window_info.top + static_cast<int>(shadow_y)) <= point[2] + bias;
 }
 
 void ShadingAlgorithm::PhongIllumination(Vertex normal, Vertex light, Vertex view, float& ambient,
@@ -3,7 +3,10 @@
 #ifndef SRC_SHADING_SHADINGALGORITHM_H_
 #define SRC_SHADING_SHADINGALGORITHM_H_
 
+#include "./clipper.h"
+#include "./rasterizer.h"
 #include "./shading_utils.h"
+#include "../framebuffer.h"
 #include "../teapot_utils.h"
 #include "../triangle_mesh.h"
 
@@ -28,15 +31,20 @@ class ShadingAlgorithm {
           i_s_(1.0f),
           red_strength_(1.0f),
           green_strength_(0.0f),
-          blue_strength_(0.0f) {
+          blue_strength_(0.0f),
+          cull_mode_(kCullBack),
+          depth_prepass_(false),
+          depth_only_(false) {
       floor_texture_ = cvLoadImage("textures/floor.jpg", CV_LOAD_IMAGE_COLOR);
     }
 
     //! \brief Calculates the shading for a scene.
     //!
-    //! The calculated shading is placed in the points variable.
-    virtual void Shade(TriangleMesh object, TriangleMesh the_floor, WindowInfo window_info,
-        Vertex light_position, Vertex view_position, std::vector<Vertex>& points,
+    //! The framebuffer is cleared, and the calculated shading is written into
+    //! it. If the framebuffer is multisampled, its samples are resolved into
+    //! its colour plane at the end.
+    virtual void Shade(TriangleMesh& object, TriangleMesh& the_floor, WindowInfo window_info,
+        Vertex light_position, Vertex view_position, Framebuffer& framebuffer,
         IplImage* image = NULL) = 0;
 
     //! \brief Renders the floor in the scene.
@@ -44,16 +52,24 @@ class ShadingAlgorithm {
     //! This differs from other objects as it does not use the full Phong
     //! Illumination.
     //!
-    //! Expects the z-buffer to be already initialised. Takes control of it during
-    //! the function, and will update it.
+    //! Expects the framebuffer to be already initialised. Visible pixels are
+    //! written to both its colour and depth planes, or its samples if it is
+    //! multisampled.
     //!
-    //! If the shadow_buffer is not empty, will use it to attempt to render
-    //! shadows as well.
-    void RenderFloor(TriangleMesh the_floor, WindowInfo window_info,
+    //! If shadows are turned on and a shadow_buffer is given, will use it to
+    //! attempt to render shadows as well.
+    void RenderFloor(TriangleMesh& the_floor, WindowInfo window_info,
         Vertex light_position, Vertex view_position,
-        std::vector<std::vector<float> >& z_buffer,
-        std::vector<std::vector<float> > shadow_buffer,
-        std::vector<Vertex>& points);
+        const DepthBuffer* shadow_buffer, Framebuffer& framebuffer);
+
+    //! \brief Checks whether the point (x, y, z) is lit, according to a shadow
+    //!        buffer rendered from the light's viewpoint.
+    //!
+    //! Points that the light cannot see at all are treated as lit. The bias is
+    //! added to the point's depth from the light before comparing it against
+    //! the shadow buffer.
+    bool IsLit(int x, int y, float z, Vertex light_position,
+        const DepthBuffer& shadow_buffer, float bias);
 
     //! \brief Calculates the Phong illumination for a given normal, light vector, and
     //!        view vector.
@@ -85,6 +101,72 @@ class ShadingAlgorithm {
     inline bool shadows() { return shadows_; }
 
     inline void ToggleShadows() { shadows_ = (shadows_) ? false : true; }
+
+    //! \brief Which triangles are culled for facing away from the viewer.
+    //!
+    //! Back faces are culled by default, which is only correct for closed
+    //! meshes whose triangles are all wound the same way.
+    inline CullMode cull_mode() { return cull_mode_; }
+    inline void set_cull_mode(CullMode cull_mode) { cull_mode_ = cull_mode; }
+
+    //! \brief Whether the scene's depths are drawn before it is shaded.
+    //!
+    //! With a depth prepass, only the fragments that end up visible are
+    //! shaded, at the cost of setting up and rasterizing the scene twice.
+    //! It pays off when the shading of each fragment is expensive.
+    inline bool depth_prepass() const { return depth_prepass_; }
+    inline void set_depth_prepass(bool depth_prepass) {
+      depth_prepass_ = depth_prepass;
+    }
+
+  protected:
+    //! \brief Calls render(), which draws the scene, once to draw only its
+    //!        depths if depth_prepass() is set, and then again to shade it.
+    //!
+    //! The second pass draws the same triangles against the final depths,
+    //! and the depth test passes fragments at least as close as the depth
+    //! buffer, so it only passes those that are exactly as close, i.e. the
+    //! visible ones.
+    template <typename RenderFunction>
+    void RenderWithDepthPrepass(RenderFunction render) {
+      if (depth_prepass_) {
+        depth_only_ = true;
+        render();
+        depth_only_ = false;
+      }
+      render();
+    }
+
+    //! \brief Rasterizes triangles into the framebuffer, as
+    //!        RasterizeTriangles() does, for RenderFloor() and the shading
+    //!        algorithms' RenderObject().
+    //!
+    //! During the first pass of RenderWithDepthPrepass(), only the depths
+    //! are drawn, and shade is never called.
+    template <typename FragmentFunction>
+    void DrawTriangles(const std::vector<TriangleSetup>& triangles,
+        Framebuffer& framebuffer, FragmentFunction shade) {
+      if (depth_only_) {
+        RasterizeTriangles(triangles, framebuffer,
+            [](int, int, int, float, float, float, float) {});
+      } else {
+        RasterizeTriangles(triangles, framebuffer, shade);
+      }
+    }
+
+    //! \brief Sets up the floor's triangles for rasterizing, as
+    //!        RenderFloor() does.
+    void SetupFloorTriangles(TriangleMesh& the_floor, WindowInfo window_info,
+        std::vector<TriangleSetup>& triangles);
+
+    //! \brief Sets the colour of the floor at pixel (x, y), which is at
+    //!        depth z, in the framebuffer.
+    //!
+    //! If shadows are turned on and a shadow_buffer is given, will use it to
+    //! darken the floor where it is in shadow.
+    void ShadeFloorPoint(int x, int y, float z, Vertex light_position,
+        const DepthBuffer* shadow_buffer, Framebuffer& framebuffer);
+
   private:
     IplImage* floor_texture_;
 
@@ -104,6 +186,13 @@ class ShadingAlgorithm {
 
     // Shadows
     bool shadows_;
+
+    CullMode cull_mode_;
+
+    bool depth_prepass_;
+
+    //! True during the depth-only pass of RenderWithDepthPrepass().
+    bool depth_only_;
 };
 }
 
@@ -2,7 +2,63 @@
 
 #include "./shading_utils.h"
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "../job_system.h"
+
 namespace computer_graphics {
+
+namespace {
+//! Projects the points in [begin, end), as Project() does.
+void ProjectRange(const VertexStream& points, Vertex view_position,
+    int width, int height, int begin, int end, VertexStream& projected) {
+  const float dist = -2.0f;
+  const float half_width = width / 2;
+  const float half_height = height / 2;
+
+  const float* in_x = points.x().data();
+  const float* in_y = points.y().data();
+  const float* in_z = points.z().data();
+  float* out_x = projected.x().data();
+  float* out_y = projected.y().data();
+  float* out_z = projected.z().data();
+
+  int i = begin;
+#if defined(__SSE__)
+  const __m128 view_x = _mm_set1_ps(view_position[0]);
+  const __m128 view_y = _mm_set1_ps(view_position[1]);
+  const __m128 view_z = _mm_set1_ps(view_position[2]);
+  const __m128 dist4 = _mm_set1_ps(dist);
+  const __m128 half_width4 = _mm_set1_ps(half_width);
+  const __m128 half_height4 = _mm_set1_ps(half_height);
+  for (; i + 4 <= end; i += 4) {
+    __m128 x = _mm_sub_ps(_mm_loadu_ps(in_x + i), view_x);
+    __m128 y = _mm_sub_ps(_mm_loadu_ps(in_y + i), view_y);
+    __m128 z = _mm_sub_ps(_mm_loadu_ps(in_z + i), view_z);
+
+    x = _mm_mul_ps(_mm_div_ps(_mm_mul_ps(dist4, x), z), half_width4);
+    y = _mm_mul_ps(_mm_div_ps(_mm_mul_ps(dist4, y), z), half_height4);
+
+    _mm_storeu_ps(out_x + i, x);
+    _mm_storeu_ps(out_y + i, y);
+    _mm_storeu_ps(out_z + i, z);
+  }
+#endif
+
+  for (; i < end; i++) {
+    float x = in_x[i] - view_position[0];
+    float y = in_y[i] - view_position[1];
+    float z = in_z[i] - view_position[2];
+
+    out_x[i] = ((dist * x) / z) * half_width;
+    out_y[i] = ((dist * y) / z) * half_height;
+    out_z[i] = z;
+  }
+}
+}  // namespace
+
 void Project(Vertex& vector, Vertex view_position, int width, int height) {
   float dist = -2.0f;
 
@@ -19,6 +75,15 @@ void Project(Vertex& vector, Vertex view_position, int width, int height) {
   vector[2] = z;
 }
 
+void ProjectPoints(const VertexStream& points, Vertex view_position,
+    int width, int height, VertexStream& projected) {
+  projected.resize(points.size());
+  Jobs().ParallelForBlocks(points.size(), kStreamBlockSize,
+      [&](int begin, int end) {
+    ProjectRange(points, view_position, width, height, begin, end, projected);
+  });
+}
+
 void Normalise(Vertex &v) {
   float length = std::sqrt((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
 
@@ -48,40 +113,4 @@ void ComputeSurfaceNormal(Vertex p1, Vertex p2, Vertex p3, Vertex& normal) {
 
   Normalise(normal);
 }
-
-//! Used to calculate barycentric coordinates.
-//! f_ab(x, y) = (y_a - y_b)x + (x_b - x_a)y + (x_a * y_b) - (x_b * y_a)
-int f(int ax, int ay, int bx, int by, int x, int y) {
-  return (ay - by) * x + (bx - ax) * y + (ax * by) - (bx * ay);
-}
-
-bool InTriangle(int x, int y, Vertex p1, Vertex p2, Vertex p3) {
-  float alpha;
-  float beta;
-  float gamma;
-  CalculateBarycentricCoordinates(x, y, p1, p2, p3, alpha, beta, gamma);
-
-  return alpha >= 0 && alpha <= 1 && beta >= 0 && beta <= 1 && gamma >= 0 && gamma <= 1;
-}
-
-void CalculateBarycentricCoordinates(int x, int y, Vertex p1, Vertex p2,
-    Vertex p3, float& alpha, float& beta, float& gamma) {
-  int x0 = p1[0];
-  int y0 = p1[1];
-
-  int x1 = p2[0];
-  int y1 = p2[1];
-
-  int x2 = p3[0];
-  int y2 = p3[1];
-
-  // alpha = f_12(x,y) / f_12(x0, y0);
-  alpha = (float) f(x1, y1, x2, y2, x, y) / (float) f(x1, y1, x2, y2, x0, y0);
-
-  // beta = f_20(x,y) / f_20(x1, y1);
-  beta = (float) f(x2, y2, x0, y0, x, y) / (float) f(x2, y2, x0, y0, x1, y1);
-
-  // gamma = f_01(x,y) / f_01(x2, y2);
-  gamma = (float) f(x0, y0, x1, y1, x, y) / (float) f(x0, y0, x1, y1, x2, y2);
-}
 }  // namespace computer_graphics
@@ -8,11 +8,20 @@
 #include <opencv/highgui.h>
 
 #include "../vertex.h"
+#include "../vertex_stream.h"
 
 namespace computer_graphics {
 //! Projects a vector to be seen from view_position.
 void Project(Vertex& vector, Vertex view_position, int width, int height);
 
+//! \brief Projects every point in a stream to be seen from view_position,
+//!        writing the results to projected.
+//!
+//! Gives exactly the same results as calling Project() on each point, but
+//! works on several points at a time, spread across the job system.
+void ProjectPoints(const VertexStream& points, Vertex view_position,
+    int width, int height, VertexStream& projected);
+
 //! Normalises a vertex, making it's magnitude one.
 void Normalise(Vertex& v);
 
@@ -24,14 +33,6 @@ float DotProduct(Vertex a, Vertex b);
 //!
 //! Assumes that p1, p2, p3 are given in clockwise order.
 void ComputeSurfaceNormal(Vertex p1, Vertex p2, Vertex p3, Vertex& normal);
-
-//! Checks if a point (x,y) is in the triangle given by p1, p2, and p3.
-bool InTriangle(int x, int y, Vertex p1, Vertex p2, Vertex p3);
-
-//! \brief Calculates the barycentric coordinates for a point (x,y) in the
-//! triangle p1, p2, p3.
-void CalculateBarycentricCoordinates(int, int, Vertex, Vertex, Vertex,
-    float& alpha, float& beta, float& gamma);
 }  // namespace computer_graphics
 
 #endif  // SRC_SHADING_SHADINGUTILS_H_
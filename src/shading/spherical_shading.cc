@@ -4,131 +4,85 @@
 
 namespace computer_graphics {
 
-//! A z-buffer approach is used to draw points in the correct order. Note that
-//! multiple entries may exist in points for a single coordinate, so the drawing
-//! must be done by iterating from the front of the points vector to the back.
-void SphericalShading::Shade(TriangleMesh object, TriangleMesh the_floor,
+//! A z-buffer approach is used to draw points in the correct order; the depth
+//! plane of the framebuffer serves as the z-buffer.
+void SphericalShading::Shade(TriangleMesh& object, TriangleMesh& the_floor,
     WindowInfo window_info, Vertex light_position, Vertex view_position,
-    std::vector<Vertex>& points, IplImage* image) {
-  int window_width = std::abs(window_info.left) + std::abs(window_info.right);
-  int window_height = std::abs(window_info.top) + std::abs(window_info.bottom);
+    Framebuffer& framebuffer, IplImage* image) {
+  // Transform the meshes' vertices into world space in one batch, before any
+  // jobs start reading them.
+  object.UpdateVertices();
+  the_floor.UpdateVertices();
 
   // Initialise the z-buffer.
-  std::vector<std::vector<float>  > z_buffer;
-  for (int i = 0; i <= window_width; i++) {
-    std::vector<float> line(window_height + 1, -1000.0f);
-    z_buffer.push_back(line);
-  }
-
-  // Spherical environment mapping doesn't implement shadows.
-  std::vector<std::vector<float> > shadow_buffer;
-
-  RenderObject(object, window_info, light_position, view_position, z_buffer,
-      points, image);
-  RenderFloor(the_floor, window_info, light_position, view_position, z_buffer,
-      shadow_buffer, points);
+  framebuffer.Clear();
+
+  RenderWithDepthPrepass([&]() {
+    RenderObject(object, window_info, light_position, view_position,
+        framebuffer, image);
+
+    // Spherical environment mapping doesn't implement shadows.
+    RenderFloor(the_floor, window_info, light_position, view_position, NULL,
+        framebuffer);
+  });
+
+  // Average the samples of a multisampled framebuffer into its colours.
+  framebuffer.Resolve();
 }
 
-void SphericalShading::RenderObject(TriangleMesh the_object,
+void SphericalShading::RenderObject(TriangleMesh& the_object,
     WindowInfo window_info, Vertex light_position, Vertex view_position,
-    std::vector<std::vector<float> >& z_buffer,
-    std::vector<Vertex>& points, IplImage* image) {
-  int window_width = std::abs(window_info.left) + std::abs(window_info.right);
-  int window_height = std::abs(window_info.top) + std::abs(window_info.bottom);
-
-  // Compute the triangle normals.
-  std::vector<Vertex> triangle_normals;
-  for (int i = 0; i < the_object.trigNum(); i++) {
-    Vertex p1;
-    Vertex p2;
-    Vertex p3;
-    Vertex trNormal;
-    the_object.GetTriangleVertices(i, p1, p2, p3);
-    ComputeSurfaceNormal(p1, p2, p3, trNormal);
-    triangle_normals.push_back(trNormal);
-  }
-
-  // Compute the vertex normals
-  std::vector<Vertex> vertex_normals;
-  for (int i = 0; i < the_object.vNum(); i++) {
-    Vertex vNormal;
-    std::vector<int> triangles = the_object.GetTrianglesForVertex(i);
-    for (std::vector<int>::iterator it = triangles.begin();
-        it != triangles.end(); it++) {
-      vNormal[0] += triangle_normals[(*it)][0];
-      vNormal[1] += triangle_normals[(*it)][1];
-      vNormal[2] += triangle_normals[(*it)][2];
-    }
-    vNormal[0] /= triangles.size();
-    vNormal[1] /= triangles.size();
-    vNormal[2] /= triangles.size();
-
-    vertex_normals.push_back(vNormal);
-  }
+    Framebuffer& framebuffer, IplImage* image) {
+  // The mesh caches its normals between frames.
+  const VertexStream& vertex_normals = the_object.vertex_normals();
+  Span<const float> normal_x = vertex_normals.x();
+  Span<const float> normal_y = vertex_normals.y();
+  Span<const float> normal_z = vertex_normals.z();
+
+  // Spherical mapping draws the world-space positions directly.
+  const VertexStream& positions = the_object.positions();
+
+  // Set up the triangles in the object.
+  std::vector<TriangleSetup> triangles;
+  SetupTriangles(the_object.trigNum(), triangles,
+      [&](int i, ClippedTriangle& clipped) -> TriangleFate {
+    const Triangle& vertices = the_object.triangle(i);
+    Vertex p1 = positions.Get(vertices[0]);
+    Vertex p2 = positions.Get(vertices[1]);
+    Vertex p3 = positions.Get(vertices[2]);
+
+    // Set up the triangle's edge functions and bounding box.
+    return SetupTriangle(p1, p2, p3, window_info, cull_mode(), clipped);
+  });
 
   // Render the triangles in the object.
-  for (int i = 0; i < the_object.trigNum(); i++) {
-    std::vector<int> vertices;
-    the_object.GetTriangleVerticesInt(i, vertices);
-    Vertex p1 = the_object.v(vertices[0]);
-    Vertex p2 = the_object.v(vertices[1]);
-    Vertex p3 = the_object.v(vertices[2]);
-
-    // For efficiency, establish a bounding box for the triangle.
-    int left = clamp(std::min(p1[0], std::min(p2[0], p3[0])),
-        window_info.left, window_info.right);
-    int right = clamp(std::max(p1[0], std::max(p2[0], p3[0])),
-        window_info.left, window_info.right);
-    int top = clamp(std::min(p1[1], std::min(p2[1], p3[1])),
-        window_info.top, window_info.bottom);
-    int bottom = clamp(std::max(p1[1], std::max(p2[1], p3[1])),
-        window_info.top, window_info.bottom);
-
-    for (int y = top; y <= bottom; y++) {
-      for (int x = left; x <= right; x++) {
-        // Skip non-triangle pixels.
-        if (!InTriangle(x, y, p1, p2, p3)) {
-          continue;
-        }
-        float alpha;
-        float beta;
-        float gamma;
-        CalculateBarycentricCoordinates(x, y, p1, p2, p3, alpha, beta, gamma);
-        float z = alpha * p1[2] + beta * p2[2] + gamma * p3[2];
-
-        // Skip hidden pixels.
-        if (z_buffer[x + window_width / 2][y + window_height / 2] > z) {
-          continue;
-        }
-        z_buffer[x + window_width / 2][y + window_height / 2] = z;
-
-        // Interpolate the normal vector for the point from the vertex normals.
-        Vertex point_normal;
-        point_normal[0] = (alpha * vertex_normals[vertices[0]][0]) +
-            (beta * vertex_normals[vertices[1]][0]) +
-            (gamma * vertex_normals[vertices[2]][0]);
-        point_normal[1] = (alpha * vertex_normals[vertices[0]][1]) +
-            (beta * vertex_normals[vertices[1]][1]) +
-            (gamma * vertex_normals[vertices[2]][1]);
-        point_normal[2] = (alpha * vertex_normals[vertices[0]][2]) +
-            (beta * vertex_normals[vertices[1]][2]) +
-            (gamma * vertex_normals[vertices[2]][2]);
-
-        Vertex light(light_position[0] - x, light_position[1] - y,
-            light_position[2] - z);
-        Normalise(light);
-
-        Vertex view(view_position[0] -  x, view_position[1] - y,
-            view_position[2] - z);
-        Normalise(view);
-
-        std::vector<float> colour;
-        SphericalEnvironmentMap(point_normal, light, view, colour, image);
-
-        points.push_back(Vertex(x, y, z, colour[0], colour[1], colour[2]));
-      }
-    }
-  }
+  DrawTriangles(triangles, framebuffer,
+      [&](int triangle, int x, int y, float z, float alpha, float beta,
+          float gamma) {
+    const Triangle& vertices = the_object.triangle(triangle);
+
+    // Interpolate the normal vector for the point from the vertex normals.
+    Vertex point_normal;
+    point_normal[0] = (alpha * normal_x[vertices[0]]) +
+        (beta * normal_x[vertices[1]]) + (gamma * normal_x[vertices[2]]);
+    point_normal[1] = (alpha * normal_y[vertices[0]]) +
+        (beta * normal_y[vertices[1]]) + (gamma * normal_y[vertices[2]]);
+    point_normal[2] = (alpha * normal_z[vertices[0]]) +
+        (beta * normal_z[vertices[1]]) + (gamma * normal_z[vertices[2]]);
+
+    Vertex light(light_position[0] - x, light_position[1] - y,
+        light_position[2] - z);
+    Normalise(light);
+
+    Vertex view(view_position[0] -  x, view_position[1] - y,
+        view_position[2] - z);
+    Normalise(view);
+
+    std::vector<float> colour;
+    SphericalEnvironmentMap(point_normal, light, view, colour, image);
+
+    framebuffer.SetColour(x, y, colour[0], colour[1], colour[2]);
+  });
 }
 
 void SphericalShading::SphericalEnvironmentMap(Vertex normal, Vertex light, Vertex view,
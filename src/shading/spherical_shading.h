@@ -14,23 +14,22 @@ class SphericalShading : public ShadingAlgorithm {
     inline SphericalShading() { };
 
     //! \brief Calculates the shading for each visible triangle in the mesh, and
-    //!        places it in the points variable.
+    //!        writes it into the framebuffer.
     //!
     //! Each pixel in a triangle is shaded using a spherical environment map given in
     //! the image variable.
-    void Shade(TriangleMesh object, TriangleMesh the_floor, WindowInfo window_info,
-        Vertex light_position, Vertex view_position, std::vector<Vertex>& points,
+    void Shade(TriangleMesh& object, TriangleMesh& the_floor, WindowInfo window_info,
+        Vertex light_position, Vertex view_position, Framebuffer& framebuffer,
         IplImage* image);
 
   private:
     //! \brief Renders an object in the scene.
     //!
-    //! Expects the z-buffer to be already initialised. Takes control of it during
-    //! the function, and will update it.
-    void RenderObject(TriangleMesh the_object, WindowInfo window_info,
+    //! Expects the framebuffer to be already initialised. Visible pixels are
+    //! written to both its colour and depth planes.
+    void RenderObject(TriangleMesh& the_object, WindowInfo window_info,
         Vertex light_position, Vertex view_position,
-        std::vector<std::vector<float> >& z_buffer,
-        std::vector<Vertex>& points, IplImage* image);
+        Framebuffer& framebuffer, IplImage* image);
 
     //! \brief Calculates the colour for a given normal, light vector and view vector,
     //!        based on a spherical environment map found in image.
@@ -6,7 +6,11 @@
 #include <opencv/cv.h>
 #include <opencv/highgui.h>
 
+#include "./anti_aliasing.h"
+#include "./frame_writer.h"
+#include "./framebuffer.h"
 #include "./mouse_loc.h"
+#include "./teapot_utils.h"
 #include "./triangle_mesh.h"
 #include "./shading/shading_algorithm.h"
 #include "./shading/phong_shading.h"
@@ -23,7 +27,13 @@ int current_button;
 cg::MouseLoc old_mouse_location;
 cg::WindowInfo window_info(-kWindowWidth/2, kWindowWidth/2,
     -kWindowHeight/2, kWindowHeight/2);
-bool aa = false;
+cg::AntiAliasingFilter anti_aliasing = cg::kNoAntiAliasing;
+
+// The framebuffer that the scene is shaded into.
+cg::Framebuffer framebuffer(window_info);
+
+// The frame as it is presented, as RGB bytes.
+std::vector<unsigned char> pixels;
 
 cg::TriangleMesh the_object;
 cg::TriangleMesh the_floor;
@@ -43,78 +53,171 @@ cg::Vertex light(75.0f, 75.0f, 0.0f);
 cg::Vertex view(0.0f, 0.0f, 0.0f);
 
 // Forward declarations.
+void PrintUsage(const char*);
+void PrintAlgorithms();
+int CountFrameNumbers(const char*);
+int RenderHeadless(const char*, int, float);
 void display();
 void mouseDragged(int, int);
 void mouseClicked(int, int, int, int);
 void keyboard(unsigned char, int, int);
 
 int main(int argc, char **argv) {
-  char* filename;
-  if (argc == 2) {
-    // The default shading algorithm is Phong Shading.
-    shading_algorithm = &phong_shading;
-    filename = argv[1];
-  } else if (argc == 4 && strcmp(argv[1], "-s") == 0) {
-    if (strcmp(argv[2], "Flat") == 0) {
-      shading_algorithm = &flat_shading;
-    } else if (strcmp(argv[2], "Gourard") == 0) {
-      shading_algorithm = &gourard_shading;
-    } else if (strcmp(argv[2], "Phong") == 0) {
-      shading_algorithm = &phong_shading;
-    } else if (strcmp(argv[2], "Spherical") == 0) {
-      shading_algorithm = &spherical_shading;
-      spherical_texture_map =
-          cvLoadImage("textures/gl_map.jpg", CV_LOAD_IMAGE_COLOR);
+  // The default shading algorithm is Phong Shading.
+  shading_algorithm = &phong_shading;
+
+  char* filename = NULL;
+  const char* output_pattern = NULL;
+  int num_frames = 1;
+  float rotation_per_frame = 0.0f;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "Flat") == 0) {
+        shading_algorithm = &flat_shading;
+      } else if (strcmp(argv[i], "Gourard") == 0) {
+        shading_algorithm = &gourard_shading;
+      } else if (strcmp(argv[i], "Phong") == 0) {
+        shading_algorithm = &phong_shading;
+      } else if (strcmp(argv[i], "Spherical") == 0) {
+        shading_algorithm = &spherical_shading;
+        spherical_texture_map =
+            cvLoadImage("textures/gl_map.jpg", CV_LOAD_IMAGE_COLOR);
+      } else {
+        fprintf(stderr, "Error: Unrecognized algorithm '%s'.\n\n", argv[i]);
+        PrintAlgorithms();
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output_pattern = argv[++i];
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      num_frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      rotation_per_frame = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+      i++;
+      bool found = false;
+      for (int k = cg::kScalarKernel; k <= cg::kAvx2Kernel; k++) {
+        cg::SpanKernel kernel = static_cast<cg::SpanKernel>(k);
+        if (strcmp(argv[i], cg::SpanKernelName(kernel)) == 0) {
+          found = true;
+          if (!cg::SetSpanKernel(kernel)) {
+            fprintf(stderr, "Error: This CPU does not support the %s "
+                "kernel.\n", argv[i]);
+            return 1;
+          }
+        }
+      }
+      if (!found) {
+        fprintf(stderr, "Error: Unrecognized kernel '%s'.\n\n", argv[i]);
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      i++;
+      bool found = false;
+      for (int k = 0; k < cg::kNumAntiAliasingFilters; k++) {
+        cg::AntiAliasingFilter filter = static_cast<cg::AntiAliasingFilter>(k);
+        if (strcmp(argv[i], cg::AntiAliasingFilterName(filter)) == 0) {
+          found = true;
+          anti_aliasing = filter;
+        }
+      }
+      if (!found) {
+        fprintf(stderr, "Error: Unrecognized anti-aliasing filter '%s'.\n\n",
+            argv[i]);
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      if (!framebuffer.SetSamples(atoi(argv[++i]))) {
+        fprintf(stderr, "Error: Multisampling takes 2, 4 or 8 samples.\n\n");
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "-d") == 0) {
+      phong_shading.set_deferred(true);
+    } else if (strcmp(argv[i], "-b") == 0) {
+      cg::ShadingAlgorithm* algorithms[] = {
+        &phong_shading, &gourard_shading, &flat_shading, &spherical_shading
+      };
+      for (int k = 0; k < 4; k++) {
+        algorithms[k]->set_cull_mode(cg::kCullNone);
+      }
+    } else if (strcmp(argv[i], "-z") == 0) {
+      cg::ShadingAlgorithm* algorithms[] = {
+        &phong_shading, &gourard_shading, &flat_shading, &spherical_shading
+      };
+      for (int k = 0; k < 4; k++) {
+        algorithms[k]->set_depth_prepass(true);
+      }
+    } else if (strcmp(argv[i], "-f") == 0) {
+      cg::SetTriangleOrder(cg::kFrontToBack);
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      int num_threads = atoi(argv[++i]);
+      if (num_threads < 1) {
+        fprintf(stderr, "Error: Need at least one thread.\n\n");
+        PrintUsage(argv[0]);
+        return 1;
+      }
+      cg::SetJobThreads(num_threads);
+    } else if (argv[i][0] != '-' && filename == NULL) {
+      filename = argv[i];
     } else {
-      fprintf(stderr, "Error: Unrecognized algorithm '%s'.\n\n", argv[2]);
-      fprintf(stderr, "Possible shading algorithms are:\n");
-      fprintf(stderr, "    Flat\n");
-      fprintf(stderr, "    Gourard\n");
-      fprintf(stderr, "    Phong\n");
-      fprintf(stderr, "    Spherical\n");
+      filename = NULL;
+      break;
+    }
+  }
 
+  if (filename == NULL || num_frames < 1) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // The pattern is used as a printf format, so it may only take the frame
+  // number, and must do so if there is more than one frame.
+  if (output_pattern != NULL) {
+    int frame_numbers = CountFrameNumbers(output_pattern);
+    if (frame_numbers < 0 || frame_numbers > 1 ||
+        (frame_numbers == 0 && num_frames > 1)) {
+      fprintf(stderr, "Error: The output file must contain one frame number "
+          "(e.g. %%04d), or none\nfor a single frame, and write any other %% "
+          "as %%%%.\n\n");
+      PrintUsage(argv[0]);
       return 1;
     }
-    filename = argv[3];
-  } else {
-    fprintf(stderr, "Usage: %s [-s shading_algorithm] filename \n\n", argv[0]);
-    fprintf(stderr, "Possible shading algorithms are:\n");
-    fprintf(stderr, "    Flat\n");
-    fprintf(stderr, "    Gourard\n");
-    fprintf(stderr, "    Phong\n");
-    fprintf(stderr, "    Spherical\n");
-    return 1;
   }
+
   the_object.LoadFile(filename);
   the_floor.LoadFile("objects/floor.obj", false);
 
   // The object and floor must be moved "back" in the scene,
   // as the view is at (0,0,0).
-  cg::FloatMatrix f(4, 4);
+  cg::Mat4 f;
   cg::CreateMovMatrix(f, 0, 0, -500);
   the_object.ApplyTransformation(f);
   the_floor.ApplyTransformation(f);
 
   // The floor must also be moved so that it lies below the object.
   if (the_object.vNum() > 0) {
-    float miny = the_object.v(0)[1];
-    for (int i = 1; i < the_object.vNum(); i++) {
-      float y = the_object.v(i)[1];
-      if (y < miny) {
-        miny = y;
-      }
-    }
-    cg::FloatMatrix i(4, 4);
-    cg::CreateMovMatrix(i, 0, miny, 0);
+    cg::Vertex min;
+    cg::Vertex max;
+    the_object.GetBounds(min, max);
+    cg::Mat4 i;
+    cg::CreateMovMatrix(i, 0, min[1], 0);
     the_floor.ApplyTransformation(i);
   }
 
   // Finally, the objects are rotated so that the floor is visible.
-  cg::FloatMatrix g(4, 4);
+  cg::Mat4 g;
   cg::CreateXRotMatrix(g, 20);
   the_object.ApplyTransformation(g);
   the_floor.ApplyTransformation(g);
 
+  if (output_pattern != NULL) {
+    return RenderHeadless(output_pattern, num_frames, rotation_per_frame);
+  }
+
   // OpenGL setup.
   glutInit(&argc, argv);
   glutInitWindowSize(kWindowWidth, kWindowHeight);
@@ -122,6 +225,7 @@ int main(int argc, char **argv) {
 
   gluOrtho2D(-kWindowWidth/2, kWindowWidth/2,
       -static_cast<int>(kWindowHeight/2), static_cast<int>(kWindowHeight/2));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
   // Callback functions
   glutDisplayFunc(display);
@@ -135,136 +239,178 @@ int main(int argc, char **argv) {
   return 0;
 }
 
-//! \brief Called whenever OpenGL is redrawing the screen.
-void display() {
-  glClear(GL_COLOR_BUFFER_BIT);
-
-  std::vector<cg::Vertex> points;
-  shading_algorithm->Shade(the_object, the_floor, window_info, light, view,
-      points, spherical_texture_map);
+void PrintUsage(const char* program) {
+  fprintf(stderr, "Usage: %s [-s shading_algorithm] [-k kernel] [-a filter] [-m samples] "
+      "[-d] [-z] [-b] [-f] [-t threads] [-o output_file [-n frames] [-r degrees]] filename \n\n", program);
+  fprintf(stderr, "If -o is given, no window is opened. Instead, the scene is "
+      "rendered\noffscreen and each frame is written to output_file, which "
+      "must contain a\nprintf-style frame number (e.g. frame_%%04d.ppm) "
+      "unless -n is 1; any other\n%% must be written as %%%%. Frames are "
+      "written as PPM, or in any format\nOpenCV recognises from the "
+      "extension (e.g. PNG). The object is rotated by\n-r degrees around "
+      "the y-axis between frames.\n\n");
+  fprintf(stderr, "The -k option forces the rasterizer to use the scalar, "
+      "sse2 or avx2 kernel.\nBy default the fastest one that the CPU "
+      "supports is used.\n\n");
+  fprintf(stderr, "The -a option applies the cross or fxaa anti-aliasing "
+      "filter to each\nframe. The cross filter averages each pixel with its "
+      "four neighbours; the\nfxaa filter only blends pixels across edges. "
+      "In the window, the / key\nswitches between them.\n\n");
+  fprintf(stderr, "The -m option renders with 2, 4 or 8 samples per pixel, "
+      "which are\naveraged into each pixel's colour. Each pixel is still "
+      "shaded once per\ntriangle. In the window, the , key switches between "
+      "them.\n\n");
+  fprintf(stderr, "The -d option makes Phong shading deferred: the scene's "
+      "normals are\nrasterized first, and then each visible pixel is shaded "
+      "once. It has no\neffect when multisampling.\n\n");
+  fprintf(stderr, "The -z option draws the scene's depths before shading "
+      "it, so that\nonly the visible pixels are shaded, at the cost of "
+      "drawing the scene twice.\n\n");
+  fprintf(stderr, "The -b option draws back-facing triangles, which are "
+      "otherwise culled.\nIt is needed for meshes that are not closed, or "
+      "whose triangles are not\nall wound the same way.\n\n");
+  fprintf(stderr, "The -f option draws each mesh's triangles from front to "
+      "back, so that\nmore of the hidden ones are skipped without being "
+      "shaded. Where triangles\nmeet at exactly the same depth, a different "
+      "one may be drawn.\n\n");
+  fprintf(stderr, "The -t option sets the number of threads that transform, "
+      "shade and\nrasterize the scene. By default there is one per hardware "
+      "thread.\n\n");
+  PrintAlgorithms();
+}
 
-  if (aa) {
+void PrintAlgorithms() {
+  fprintf(stderr, "Possible shading algorithms are:\n");
+  fprintf(stderr, "    Flat\n");
+  fprintf(stderr, "    Gourard\n");
+  fprintf(stderr, "    Phong\n");
+  fprintf(stderr, "    Spherical\n");
+}
 
-    std::vector<std::vector<std::vector<float> > > normal;
-    normal.resize(kWindowWidth + 1);
-    for (int i = 0; i <= kWindowWidth; i++) {
-      normal[i].resize(kWindowHeight + 1);
-      for (int j = 0; j <= kWindowHeight; j++) {
-        normal[i][j].resize(3);
-      }
+//! \brief Returns the number of integer conversions, such as %d or %04d, in
+//!        an output file pattern, or -1 if it has any other conversion.
+//!
+//! The only other conversion allowed is %%.
+int CountFrameNumbers(const char* pattern) {
+  int count = 0;
+  for (const char* c = pattern; *c != '\0'; c++) {
+    if (*c != '%') {
+      continue;
     }
-
-    std::vector<std::vector<std::vector<float> > > right;
-    right.resize(kWindowWidth + 2);
-    for (int i = 0; i <= kWindowWidth + 1; i++) {
-      right[i].resize(kWindowHeight + 1);
-      for (int j = 0; j <= kWindowHeight; j++) {
-        right[i][j].resize(3);
-      }
+    c++;
+    if (*c == '%') {
+      continue;
     }
-
-    std::vector<std::vector<std::vector<float> > > down;
-    down.resize(kWindowWidth + 1);
-    for (int i = 0; i <= kWindowWidth; i++) {
-      down[i].resize(kWindowHeight + 2);
-      for (int j = 0; j <= kWindowHeight + 1; j++) {
-        down[i][j].resize(3);
-      }
+    while (*c != '\0' && strchr("-+ #0", *c) != NULL) {
+      c++;
     }
-
-    std::vector<std::vector<std::vector<float> > > left;
-    left.resize(kWindowWidth + 1);
-    for (int i = 0; i <= kWindowWidth; i++) {
-      left[i].resize(kWindowHeight + 1);
-      for (int j = 0; j <= kWindowHeight; j++) {
-        left[i][j].resize(3);
+    while (*c >= '0' && *c <= '9') {
+      c++;
+    }
+    if (*c == '.') {
+      c++;
+      while (*c >= '0' && *c <= '9') {
+        c++;
       }
     }
+    if (*c != 'd' && *c != 'i') {
+      return -1;
+    }
+    count++;
+  }
+  return count;
+}
 
-    std::vector<std::vector<std::vector<float> > > up;
-    up.resize(kWindowWidth + 1);
-    for (int i = 0; i <= kWindowWidth; i++) {
-      up[i].resize(kWindowHeight + 1);
-      for (int j = 0; j <= kWindowHeight; j++) {
-        up[i][j].resize(3);
-      }
+//! \brief Renders frames without opening a window, writing each one to disk.
+//!
+//! Reports the time spent shading separately from the time spent writing
+//! frames, so that the raw rasterizer throughput can be measured.
+int RenderHeadless(const char* output_pattern, int num_frames,
+    float rotation_per_frame) {
+  double shade_time = 0.0;
+  double filter_time = 0.0;
+  double write_time = 0.0;
+  cg::ResetGeometryStats();
+
+  char filename[1024];
+  for (int frame = 0; frame < num_frames; frame++) {
+    if (frame > 0 && rotation_per_frame != 0.0f) {
+      cg::Mat4 m;
+      cg::CreateYRotMatrix(m, rotation_per_frame);
+      the_object.ApplyTransformation(m);
     }
 
-    for (std::vector<cg::Vertex>::iterator it = points.begin();
-        it != points.end(); it++) {
-      int x = (*it)[0] + kWindowWidth / 2;
-      int y = (*it)[1] + kWindowHeight / 2;
+    double start = cg::CurrentTime();
+    shading_algorithm->Shade(the_object, the_floor, window_info, light, view,
+        framebuffer, spherical_texture_map);
+    double shaded = cg::CurrentTime();
 
-      normal[x][y][0] = (*it).red();
-      normal[x][y][1] = (*it).green();
-      normal[x][y][2] = (*it).blue();
+    cg::AntiAlias(anti_aliasing, framebuffer);
+    double filtered = cg::CurrentTime();
 
-      right[x + 1][y][0] = (*it).red();
-      right[x + 1][y][1] = (*it).green();
-      right[x + 1][y][2] = (*it).blue();
+    snprintf(filename, sizeof(filename), output_pattern, frame);
+    if (!cg::WriteFrame(filename, framebuffer)) {
+      fprintf(stderr, "Error: Failed writing frame %s\n", filename);
+      return 1;
+    }
+    double written = cg::CurrentTime();
 
-      down[x][y + 1][0] = (*it).red();
-      down[x][y + 1][1] = (*it).green();
-      down[x][y + 1][2] = (*it).blue();
+    shade_time += shaded - start;
+    filter_time += filtered - shaded;
+    write_time += written - filtered;
+  }
 
-      if (x > 0) {
-        left[x - 1][y][0] = (*it).red();
-        left[x - 1][y][1] = (*it).green();
-        left[x - 1][y][2] = (*it).blue();
-      }
+  printf("Rendered %d frames with the %s kernel, %d samples per pixel, on "
+      "%d threads: %.3f ms/frame shading, %.3f ms/frame anti-aliasing (%s), "
+      "%.3f ms/frame writing (%.1f frames/s)\n", num_frames,
+      cg::SpanKernelName(cg::CurrentSpanKernel()), framebuffer.samples(),
+      cg::Jobs().num_threads(),
+      shade_time * 1000.0 / num_frames, filter_time * 1000.0 / num_frames,
+      cg::AntiAliasingFilterName(anti_aliasing),
+      write_time * 1000.0 / num_frames, num_frames / shade_time);
+
+  // Every triangle set up in a frame is counted, including the floor's and
+  // those of the shadow pass.
+  cg::GeometryStats stats = cg::CurrentGeometryStats();
+  printf("Per frame: %d triangles drawn, %d clipped, %d back-facing culled, "
+      "%d rejected\n", stats.triangles[cg::kTriangleDrawn] / num_frames,
+      stats.triangles[cg::kTriangleClipped] / num_frames,
+      stats.triangles[cg::kTriangleCulled] / num_frames,
+      stats.triangles[cg::kTriangleRejected] / num_frames);
+  return 0;
+}
 
-      if (y > 0) {
-        up[x][y - 1][0] = (*it).red();
-        up[x][y - 1][1] = (*it).green();
-        up[x][y - 1][2] = (*it).blue();
-      }
-    }
+//! \brief Called whenever OpenGL is redrawing the screen.
+//!
+//! The frame is shaded into the framebuffer, anti-aliased, converted to
+//! bytes and handed to OpenGL in a single glDrawPixels() call. The time
+//! spent on each step is printed.
+void display() {
+  double start = cg::CurrentTime();
+  shading_algorithm->Shade(the_object, the_floor, window_info, light, view,
+      framebuffer, spherical_texture_map);
+  double shaded = cg::CurrentTime();
 
-    glBegin(GL_POINTS);
-    for (int x = 0; x <= kWindowWidth; x++) {
-      for (int y = 0; y <= kWindowHeight; y++) {
-        float r;
-        float g;
-        float b;
-        if (aa) {
-          r = (normal[x][y][0] + right[x][y][0] + down[x][y][0] + left[x][y][0] + up[x][y][0]) / 5.0f;
-          g = (normal[x][y][1] + right[x][y][1] + down[x][y][1] + left[x][y][1] + up[x][y][1]) / 5.0f;
-          b = (normal[x][y][2] + right[x][y][2] + down[x][y][2] + left[x][y][2] + up[x][y][2]) / 5.0f;
-        } else {
-          r = normal[x][y][0];
-          g = normal[x][y][1];
-          b = normal[x][y][2];
-        }
+  cg::AntiAlias(anti_aliasing, framebuffer);
+  double filtered = cg::CurrentTime();
 
-        glColor3f(r, g, b);
-        glVertex2i(x - kWindowWidth / 2, y - kWindowHeight / 2);
-      }
-    }
-    glEnd();
-  } else {
-    glBegin(GL_POINTS);
-    for (std::vector<cg::Vertex>::iterator it = points.begin();
-        it != points.end(); it++) {
-      int x = (*it)[0];
-      int y = (*it)[1];
-
-      float r = (*it).red();
-      float g = (*it).green();
-      float b = (*it).blue();
-
-      glColor3f(r, g, b);
-      glVertex2i(x, y);
-    }
+  framebuffer.ReadPixels(pixels);
 
-    glEnd();
-  }
+  // The rows run bottom-up from the window's bottom-left corner.
+  glRasterPos2i(window_info.left, window_info.top);
+  glDrawPixels(kWindowWidth, kWindowHeight, GL_RGB, GL_UNSIGNED_BYTE,
+      &pixels[0]);
+  glFinish();
+  double presented = cg::CurrentTime();
 
-  glFlush();
+  printf("Shaded in %.3f ms, anti-aliased in %.3f ms, presented in %.3f "
+      "ms\n", (shaded - start) * 1000.0, (filtered - shaded) * 1000.0,
+      (presented - filtered) * 1000.0);
 }
 
 //! Called when the user hits a keyboard key.
 void keyboard(unsigned char key, int x, int y) {
-  cg::FloatMatrix m(4, 4);
+  cg::Mat4 m;
   switch (key) {
     // Move the object left, up, down, or right.
     case 'a':
@@ -374,9 +520,18 @@ void keyboard(unsigned char key, int x, int y) {
       }
       break;
 
-      // Turn anti-aliasing on/off.
+      // Switch to the next anti-aliasing filter, or back to none.
     case '/':
-      aa = (aa) ? false : true;
+      anti_aliasing = static_cast<cg::AntiAliasingFilter>(
+          (anti_aliasing + 1) % cg::kNumAntiAliasingFilters);
+      printf("Anti-aliasing: %s\n", cg::AntiAliasingFilterName(anti_aliasing));
+      break;
+
+      // Switch to the next number of samples per pixel, or back to one.
+    case ',':
+      framebuffer.SetSamples(
+          (framebuffer.samples() == 8) ? 1 : framebuffer.samples() * 2);
+      printf("Samples per pixel: %d\n", framebuffer.samples());
       break;
 
       // Turn shadows on/off.
@@ -441,8 +596,8 @@ void mouseDragged(int x, int y) {
   }
 
   if (current_button == GLUT_LEFT_BUTTON) {
-    cg::FloatMatrix a(4, 4);
-    cg::FloatMatrix b(4, 4);
+    cg::Mat4 a;
+    cg::Mat4 b;
 
     // Rotate in the Y axis for left/right, the X axis for up/down.
     cg::CreateYRotMatrix(a, dx);
@@ -451,7 +606,7 @@ void mouseDragged(int x, int y) {
     the_object.ApplyTransformation(a);
     the_object.ApplyTransformation(b);
   } else if (current_button == GLUT_RIGHT_BUTTON) {
-    cg::FloatMatrix a(4, 4);
+    cg::Mat4 a;
 
     cg::CreateMovMatrix(a, dx, -dy, 0);
     the_object.ApplyTransformation(a);
@@ -475,7 +630,7 @@ void mouseClicked(int button, int state, int x, int y) {
   }
 
   // The below applies to scrolling with the mouse wheel.
-  cg::FloatMatrix m(4, 4);
+  cg::Mat4 m;
   bool changed = false;
 
   if (button == 3) {
@@ -8,7 +8,7 @@
 #include <cmath>
 #include <cstdio>
 
-#include "./float_matrix.h"
+#include "./mat4.h"
 
 namespace computer_graphics {
 //! \struct WindowInfo
@@ -29,29 +29,37 @@ struct WindowInfo {
 
 // Matrix creation
 
+//! \brief Creates a matrix that leaves an object unchanged.
+void CreateIdentityMatrix(Mat4 &f);
+
 //! \brief Creates a matrix to rotate an object in the x-axis around
 //! the origin.
-void CreateXRotMatrix(FloatMatrix &f, float theta);
+void CreateXRotMatrix(Mat4 &f, float theta);
 
 //! \brief Creates a matrix to rotate an object in the y-axis around
 //! the origin.
-void CreateYRotMatrix(FloatMatrix &f, float theta);
+void CreateYRotMatrix(Mat4 &f, float theta);
 
 //! \brief Creates a matrix to rotate an object in the z-axis around
 //! the origin.
-void CreateZRotMatrix(FloatMatrix &f, float theta);
+void CreateZRotMatrix(Mat4 &f, float theta);
 
 //! \brief Creates a matrix to move an object in 3D space.
-void CreateMovMatrix(FloatMatrix &f, float dx, float dy, float dz);
+void CreateMovMatrix(Mat4 &f, float dx, float dy, float dz);
 
 //! \brief Creates a matrix to scale an object in 3D space.
-void CreateScaleMatrix(FloatMatrix &f, float dx, float dy, float dz);
+void CreateScaleMatrix(Mat4 &f, float dx, float dy, float dz);
 
 //! \brief Creates a matrix to shear an object in the x-axis.
-void CreateXShearMatrix(FloatMatrix &f, float dx);
+void CreateXShearMatrix(Mat4 &f, float dx);
 
 //! \brief Creates a matrix to shear an object in the x-axis.
-void CreateYShearMatrix(FloatMatrix &f, float dy);
+void CreateYShearMatrix(Mat4 &f, float dy);
+
+// Timing
+
+//! \brief Returns the current time in seconds.
+double CurrentTime();
 }  // namespace computer_graphics
 
 #endif  // SRC_TEAPOTUTILS_H_
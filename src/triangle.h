@@ -12,13 +12,16 @@ namespace computer_graphics {
 //! list.
 class Triangle {
   public:
+    Triangle() {
+    }
+
     Triangle(int v1, int v2, int v3) {
       triangle_vertices_[0] = v1;
       triangle_vertices_[1] = v2;
       triangle_vertices_[2] = v3;
     }
 
-    inline int operator[](int i) {
+    inline int operator[](int i) const {
       return triangle_vertices_[i];
     }
   private:
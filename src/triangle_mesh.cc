@@ -2,152 +2,385 @@
 
 #include "./triangle_mesh.h"
 
+#include <cmath>
+#include <utility>
+
+#include "./job_system.h"
+#include "./mesh_cache.h"
+#include "./mesh_optimiser.h"
+#include "./obj_loader.h"
+#include "./teapot_utils.h"
+#include "./shading/shading_utils.h"
+
 namespace computer_graphics {
 
-void TriangleMesh::LoadFile(const char * filename, bool scale) {
-  FILE *f;
-  f = fopen(filename, "r");
+namespace {
+//! Returns the determinant of the upper 3x3 of a matrix, which is negative
+//! if the matrix mirrors points.
+float Determinant(const Mat4& m) {
+  return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) -
+      m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0)) +
+      m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+}
 
-  if (f == NULL) {
-    fprintf(stderr, "Failed reading polygon data file %s\n", filename);
-    exit(1);
+//! \brief Returns true if the matrix only rotates points, such that normals
+//!        can be transformed by it directly.
+//!
+//! The upper 3x3 must be orthonormal with a positive determinant, and the
+//! bottom row must leave w alone. Translations are allowed, as they do not
+//! affect normals.
+bool IsRotation(const Mat4& m) {
+  const float kTolerance = 1e-4f;
+  if (std::fabs(m(3, 0)) > kTolerance || std::fabs(m(3, 1)) > kTolerance ||
+      std::fabs(m(3, 2)) > kTolerance ||
+      std::fabs(m(3, 3) - 1.0f) > kTolerance) {
+    return false;
   }
 
-  char prevBuf = '0';
-  char buf[1024];
-  char header[100];
-  float x, y, z;
-  float xmax, ymax, zmax, xmin, ymin, zmin;
-  int v1, v2, v3;
-
-  if (scale) {
-    xmax =-10000;
-    ymax =-10000;
-    zmax =-10000;
-    xmin =10000;
-    ymin =10000;
-    zmin =10000;
-  }
-
-  Vertex av;
-
-  while (fgets(buf, sizeof(buf), f) != NULL) {
-    if(buf[0] == 'v') {
-      sscanf(buf, "%s %f %f %f", header, &x, &y, &z);
-
-      mesh_vertices_.push_back(Vertex(x, y, z));
-
-      if (scale) {
-        av[0] += x;
-        av[1] += y;
-        av[2] += z;
-
-        if (x > xmax) {
-          xmax = x;
-        }
-        if (y > ymax) {
-          ymax = y;
-        }
-        if (z > zmax) {
-          zmax = z;
-        }
-
-        if (x < xmin) xmin = x;
-        if (y < ymin) ymin = y;
-        if (z < zmin) zmin = z;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      float dot = m(0, i) * m(0, j) + m(1, i) * m(1, j) + m(2, i) * m(2, j);
+      if (std::fabs(dot - (i == j ? 1.0f : 0.0f)) > kTolerance) {
+        return false;
       }
-    } else if (buf[0] == 'f') {
-      if (buf[0] != prevBuf) {
-        // Set up space for the vertex-triangle linker
-        for (int i = 0; i < vNum(); i++) {
-          std::vector<int> triangle;
-          vertices_to_triangles_.push_back(triangle);
-        }
-      }
-      sscanf(buf, "%s %d %d %d", header, &v1, &v2, &v3);
+    }
+  }
+
+  return Determinant(m) > 0.0f;
+}
 
-      Triangle trig(v1-1, v2-1, v3-1);
-      mesh_triangles_.push_back(trig);
-      vertices_to_triangles_[v1 - 1].push_back(mesh_triangles_.size() - 1);
-      vertices_to_triangles_[v2 - 1].push_back(mesh_triangles_.size() - 1);
-      vertices_to_triangles_[v3 - 1].push_back(mesh_triangles_.size() - 1);
+//! \brief Returns a matrix whose upper 3x3 transforms normals as the given
+//!        matrix transforms points, up to a scale factor.
+//!
+//! That is the inverse transpose, which equals the cofactor matrix divided by
+//! the determinant. The normals are renormalised afterwards anyway, so only
+//! the sign of the determinant is kept: a matrix that mirrors points has a
+//! negative one, and without it every normal would point inwards.
+Mat4 NormalMatrix(const Mat4& m) {
+  Mat4 result;
+  for (int row = 0; row < 3; row++) {
+    for (int col = 0; col < 3; col++) {
+      const int r1 = (row + 1) % 3;
+      const int r2 = (row + 2) % 3;
+      const int c1 = (col + 1) % 3;
+      const int c2 = (col + 2) % 3;
+      result(row, col) = m(r1, c1) * m(r2, c2) - m(r1, c2) * m(r2, c1);
     }
-    prevBuf = buf[0];
   }
 
-  if (scale) {
-    float range;
-    if (xmax-xmin > ymax-ymin) {
-      range = xmax-xmin;
-    } else {
-      range = ymax-ymin;
+  if (Determinant(m) < 0.0f) {
+    for (int row = 0; row < 3; row++) {
+      for (int col = 0; col < 3; col++) {
+        result(row, col) = -result(row, col);
+      }
     }
+  }
+  return result;
+}
 
-    for (int j = 0; j < 3; j++) av[j] /= mesh_vertices_.size();
+//! \brief Reads an OBJ file into cache, leaving out the normals of the
+//!        triangles and of vertices that the file gave none for.
+//!
+//! The triangles and vertices are reordered for locality on the way, as
+//! the cache makes that a one-off cost. Returns false, having printed the
+//! reason, if the file cannot be read.
+bool ParseMesh(const char* filename, bool scale, MeshCache& cache,
+    size_t& file_size) {
+  ObjData data;
+  if (!LoadObj(filename, scale, data)) {
+    return false;
+  }
+  file_size = data.file_size;
 
-    for (int i = 0; i < static_cast<int>(mesh_vertices_.size()); i++) {
-      for (int j = 0; j < 3; j++) {
-        mesh_vertices_[i][j] = (mesh_vertices_[i][j]-av[j])/range*400;
+  // Transformations are applied about the centre of the mesh. It is summed
+  // in file order, so that reordering the vertices does not move it.
+  const int num_vertices = data.positions.size();
+  cache.centre = Vertex();
+  cache.min = Vertex();
+  cache.max = Vertex();
+  for (int i = 0; i < num_vertices; i++) {
+    Vertex position = data.positions.Get(i);
+    for (int axis = 0; axis < 3; axis++) {
+      cache.centre[axis] += position[axis];
+      if (i == 0 || position[axis] < cache.min[axis]) {
+        cache.min[axis] = position[axis];
+      }
+      if (i == 0 || position[axis] > cache.max[axis]) {
+        cache.max[axis] = position[axis];
       }
     }
   }
+  cache.centre[0] /= num_vertices;
+  cache.centre[1] /= num_vertices;
+  cache.centre[2] /= num_vertices;
+
+  float file_acmr = AverageCacheMissRatio(data.triangles);
+  OptimiseTriangleOrder(num_vertices, data.triangles);
+  OptimiseVertexOrder(data);
+  printf("Reordered %s for the vertex cache: ACMR %.3f before, %.3f "
+      "after\n", filename, file_acmr, AverageCacheMissRatio(data.triangles));
+
+  cache.positions = std::move(data.positions);
+  cache.supplied_normals = data.normals.size() > 0;
+  cache.vertex_normals = std::move(data.normals);
+  cache.texcoords = std::move(data.texcoords);
+
+  const int num_triangles = data.triangles.size() / 3;
+  cache.triangles.resize(num_triangles);
+  for (int i = 0; i < num_triangles; i++) {
+    const int* vertices = &data.triangles[3 * i];
+    cache.triangles[i] = Triangle(vertices[0], vertices[1], vertices[2]);
+  }
+
+  // Count the triangles of each vertex, turn the counts into offsets, then
+  // place each triangle after the ones before it.
+  cache.adjacency_offsets.resize(num_vertices + 1, 0);
+  for (size_t i = 0; i < data.triangles.size(); i++) {
+    cache.adjacency_offsets[data.triangles[i] + 1]++;
+  }
+  for (int i = 0; i < num_vertices; i++) {
+    cache.adjacency_offsets[i + 1] += cache.adjacency_offsets[i];
+  }
+  cache.adjacency.resize(data.triangles.size());
+  std::vector<int> next(cache.adjacency_offsets.begin(),
+      cache.adjacency_offsets.end() - 1);
+  for (size_t i = 0; i < data.triangles.size(); i++) {
+    cache.adjacency[next[data.triangles[i]]++] = i / 3;
+  }
+  return true;
+}
+}  // namespace
+
+void TriangleMesh::LoadFile(const char * filename, bool scale) {
+  double start = CurrentTime();
+
+  char cache_filename[1024];
+  MeshCacheFilename(filename, cache_filename, sizeof(cache_filename));
+  MeshCache cache;
+  bool cached = ReadMeshCache(cache_filename, filename, scale, cache);
+  size_t file_size = 0;
+  if (!cached && !ParseMesh(filename, scale, cache, file_size)) {
+    exit(1);
+  }
+
+  object_positions_ = std::move(cache.positions);
+  object_centre_ = cache.centre;
+  object_min_ = cache.min;
+  object_max_ = cache.max;
+  object_normals_ = cache.supplied_normals ?
+      std::move(cache.vertex_normals) : VertexStream();
+  texcoords_ = std::move(cache.texcoords);
+  mesh_triangles_ = std::move(cache.triangles);
+  adjacency_offsets_ = std::move(cache.adjacency_offsets);
+  adjacency_ = std::move(cache.adjacency);
+
+  positions_ = object_positions_;
+  model_matrix_ = Mat4();
+  pending_matrix_ = Mat4();
+  pending_rotation_ = true;
+  vertices_dirty_ = false;
+  mirrored_ = false;
+
+  if (cached) {
+    // The normals in the cache were computed with an identity model matrix,
+    // which is what the mesh has now.
+    triangle_normals_ = std::move(cache.triangle_normals);
+    if (object_normals_.size() > 0) {
+      TransformSuppliedNormals();
+    } else {
+      vertex_normals_ = std::move(cache.vertex_normals);
+    }
+    normals_valid_ = true;
+  } else {
+    normals_valid_ = false;
+    UpdateNormals();
 
+    cache.positions = object_positions_;
+    cache.triangles = mesh_triangles_;
+    cache.triangle_normals = triangle_normals_;
+    cache.vertex_normals = cache.supplied_normals ?
+        object_normals_ : vertex_normals_;
+    cache.texcoords = texcoords_;
+    cache.adjacency_offsets = adjacency_offsets_;
+    cache.adjacency = adjacency_;
+    if (!WriteMeshCache(cache_filename, filename, scale, cache)) {
+      fprintf(stderr, "Could not write mesh cache %s\n", cache_filename);
+    }
+  }
+
+  double seconds = CurrentTime() - start;
   printf("Trig %i vertices %i\n", static_cast<int>(mesh_triangles_.size()),
-      static_cast<int>(mesh_vertices_.size()));
-  fclose(f);
+      positions_.size());
+  if (cached) {
+    printf("Loaded %s from %s in %.1f ms\n", filename, cache_filename,
+        seconds * 1000.0);
+  } else {
+    double megabytes = file_size / (1024.0 * 1024.0);
+    printf("Loaded %s: %.2f MB in %.1f ms (%.1f MB/s)\n", filename,
+        megabytes, seconds * 1000.0, megabytes / seconds);
+  }
 }
 
 void TriangleMesh::GetTriangleVertices(int index, Vertex &v1, Vertex &v2,
     Vertex & v3) {
-  v1 = mesh_vertices_[mesh_triangles_[index].triangle_vertices_[0]];
-  v2 = mesh_vertices_[mesh_triangles_[index].triangle_vertices_[1]];
-  v3 = mesh_vertices_[mesh_triangles_[index].triangle_vertices_[2]];
+  UpdateVertices();
+  v1 = positions_.Get(mesh_triangles_[index].triangle_vertices_[0]);
+  v2 = positions_.Get(mesh_triangles_[index].triangle_vertices_[1]);
+  v3 = positions_.Get(mesh_triangles_[index].triangle_vertices_[2]);
 }
 
-void TriangleMesh::GetTriangleVerticesInt(int index, std::vector<int>& vertices) {
-  vertices.push_back(mesh_triangles_[index].triangle_vertices_[0]);
-  vertices.push_back(mesh_triangles_[index].triangle_vertices_[1]);
-  vertices.push_back(mesh_triangles_[index].triangle_vertices_[2]);
+void TriangleMesh::GetBounds(Vertex& min, Vertex& max) {
+  for (int corner = 0; corner < 8; corner++) {
+    Vec4 point = model_matrix_ * Vec4(
+        (corner & 1) ? object_max_[0] : object_min_[0],
+        (corner & 2) ? object_max_[1] : object_min_[1],
+        (corner & 4) ? object_max_[2] : object_min_[2], 1.0f);
+    Vertex world(point.x() / point.w(), point.y() / point.w(),
+        point.z() / point.w());
+    for (int axis = 0; axis < 3; axis++) {
+      if (corner == 0 || world[axis] < min[axis]) {
+        min[axis] = world[axis];
+      }
+      if (corner == 0 || world[axis] > max[axis]) {
+        max[axis] = world[axis];
+      }
+    }
+  }
 }
 
 TriangleMesh& TriangleMesh::ApplyTransformation(
-    FloatMatrix transformation_matrix) {
-  // All transformation matrices must be 4*4.
-  if (transformation_matrix.num_cols() != 4
-      || transformation_matrix.num_rows() != 4) {
-    fprintf(stderr, "Error: Input matrix wrong size.");
-    return *this;
-  }
-
-  // Have to move teapot to origin, apply transformation, move back.
-  float middle_x = 0;
-  float middle_y = 0;
-  float middle_z = 0;
-  for (int i = 0; i < vNum(); i++) {
-    middle_x += mesh_vertices_[i][0];
-    middle_y += mesh_vertices_[i][1];
-    middle_z += mesh_vertices_[i][2];
-  }
-  middle_x /= vNum();
-  middle_y /= vNum();
-  middle_z /= vNum();
-
-  for (std::vector<Vertex>::iterator it = mesh_vertices_.begin();
-      it != mesh_vertices_.end(); it++) {
-    FloatMatrix vertex_matrix(4, 1);
-    vertex_matrix(0, 0) = (*it)[0] - middle_x;
-    vertex_matrix(0, 1) = (*it)[1] - middle_y;
-    vertex_matrix(0, 2) = (*it)[2] - middle_z;
-    vertex_matrix(0, 3) = 1.0f;
-
-    FloatMatrix result = transformation_matrix * vertex_matrix;
-
-    (*it).set_x((result(0, 0) / result(0, 3)) + middle_x);
-    (*it).set_y((result(0, 1) / result(0, 3)) + middle_y);
-    (*it).set_z((result(0, 2) / result(0, 3)) + middle_z);
-  }
+    const Mat4& transformation_matrix) {
+  // Have to move teapot to origin, apply transformation, move back. The
+  // centre is tracked through the model matrix rather than recomputed from
+  // the vertices.
+  Vec4 middle = model_matrix_ *
+      Vec4(object_centre_[0], object_centre_[1], object_centre_[2], 1.0f);
+  float middle_x = middle.x() / middle.w();
+  float middle_y = middle.y() / middle.w();
+  float middle_z = middle.z() / middle.w();
+
+  Mat4 about_centre = Mat4::Translation(middle_x, middle_y, middle_z) *
+      transformation_matrix *
+      Mat4::Translation(-middle_x, -middle_y, -middle_z);
+
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  model_matrix_ = about_centre * model_matrix_;
+  pending_matrix_ = about_centre * pending_matrix_;
+  pending_rotation_ = pending_rotation_ && IsRotation(transformation_matrix);
+  vertices_dirty_.store(true, std::memory_order_release);
 
   return *this;
 }
 
+void TriangleMesh::TransformVertices() {
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  if (!vertices_dirty_.load(std::memory_order_relaxed)) {
+    // Another thread got here first.
+    return;
+  }
+
+  const Mat4 model_matrix = model_matrix_;
+  Jobs().ParallelForBlocks(vNum(), kStreamBlockSize, [&](int begin, int end) {
+    TransformPoints(model_matrix, object_positions_, begin, end, positions_);
+  });
+
+  // Mirroring the mesh turns its triangles inside out, so reverse their
+  // winding to keep it counter-clockwise about the outward normals. The
+  // normals computed from the triangles, and back-face culling, then follow
+  // without knowing about the mirroring. A mirroring is never a rotation,
+  // so the normals are recomputed below.
+  const bool mirrored = Determinant(model_matrix) < 0.0f;
+  if (mirrored != mirrored_) {
+    Jobs().ParallelForBlocks(trigNum(), kStreamBlockSize,
+        [&](int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        int* vertices = mesh_triangles_[i].triangle_vertices_;
+        std::swap(vertices[1], vertices[2]);
+      }
+    });
+    mirrored_ = mirrored;
+  }
+
+  // Rotating the mesh rotates its normals by the same amount, which is far
+  // cheaper than rebuilding them.
+  if (normals_valid_ && pending_rotation_) {
+    Jobs().ParallelForBlocks(trigNum(), kStreamBlockSize,
+        [&](int begin, int end) {
+      RotateDirections(pending_matrix_, begin, end, triangle_normals_);
+    });
+    Jobs().ParallelForBlocks(vNum(), kStreamBlockSize,
+        [&](int begin, int end) {
+      RotateDirections(pending_matrix_, begin, end, vertex_normals_);
+    });
+  } else {
+    normals_valid_ = false;
+  }
+
+  pending_matrix_ = Mat4();
+  pending_rotation_ = true;
+  vertices_dirty_.store(false, std::memory_order_release);
+}
+
+void TriangleMesh::UpdateNormals() {
+  triangle_normals_.resize(trigNum());
+  Jobs().ParallelFor(trigNum(), [&](int i) {
+    Vertex p1;
+    Vertex p2;
+    Vertex p3;
+    GetTriangleVertices(i, p1, p2, p3);
+    Vertex normal;
+    ComputeSurfaceNormal(p1, p2, p3, normal);
+    triangle_normals_.Set(i, normal[0], normal[1], normal[2]);
+  });
+
+  if (object_normals_.size() == vNum()) {
+    // The file gave the normals, so they only need to follow the model
+    // matrix.
+    TransformSuppliedNormals();
+    normals_valid_ = true;
+    return;
+  }
+
+  vertex_normals_.resize(vNum());
+  Span<const float> triangle_x = triangle_normals_.x();
+  Span<const float> triangle_y = triangle_normals_.y();
+  Span<const float> triangle_z = triangle_normals_.z();
+  // Each block of vertices reads one contiguous run of the adjacency.
+  Jobs().ParallelForBlocks(vNum(), kStreamBlockSize, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      Span<const int> triangles = GetTrianglesForVertex(i);
+      Vertex normal;
+      for (size_t j = 0; j < triangles.size(); j++) {
+        normal[0] += triangle_x[triangles[j]];
+        normal[1] += triangle_y[triangles[j]];
+        normal[2] += triangle_z[triangles[j]];
+      }
+      normal[0] /= triangles.size();
+      normal[1] /= triangles.size();
+      normal[2] /= triangles.size();
+
+      vertex_normals_.Set(i, normal[0], normal[1], normal[2]);
+    }
+  });
+
+  normals_valid_ = true;
+}
+
+void TriangleMesh::TransformSuppliedNormals() {
+  vertex_normals_.resize(vNum());
+  const Mat4 normal_matrix = NormalMatrix(model_matrix_);
+  Jobs().ParallelForBlocks(vNum(), kStreamBlockSize, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      Vertex normal = object_normals_.Get(i);
+      vertex_normals_.Set(i, normal[0], normal[1], normal[2]);
+    }
+    RotateDirections(normal_matrix, begin, end, vertex_normals_);
+    for (int i = begin; i < end; i++) {
+      Vertex normal = vertex_normals_.Get(i);
+      Normalise(normal);
+      vertex_normals_.Set(i, normal[0], normal[1], normal[2]);
+    }
+  });
+}
+
 }  // namespace computer_graphics
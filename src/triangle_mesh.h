@@ -3,25 +3,45 @@
 #ifndef SRC_TRIANGLEMESH_H_
 #define SRC_TRIANGLEMESH_H_
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
 
-#include "./float_matrix.h"
+#include "./buffer.h"
+#include "./mat4.h"
 #include "./triangle.h"
 #include "./vertex.h"
+#include "./vertex_stream.h"
 
 namespace computer_graphics {
 
 //! \class TriangleMesh
 //! \brief Represents a polygon implemented as a mesh of triangles.
+//!
+//! The vertices are kept as they were loaded, in object space, along with a
+//! model matrix that places them in the world. Transformations only update
+//! the model matrix; the world-space vertices are recomputed in one batch the
+//! next time they are read.
+//!
+//! Positions and normals are held as structure-of-arrays VertexStreams, so
+//! that the batched transform and projection kernels can read them directly.
 class TriangleMesh {
   public:
-    explicit TriangleMesh(char * filename) {
+    explicit TriangleMesh(char * filename)
+        : pending_rotation_(true),
+          vertices_dirty_(false),
+          mirrored_(false),
+          normals_valid_(false) {
       LoadFile(filename);
     }
 
-    TriangleMesh() {
+    TriangleMesh()
+        : pending_rotation_(true),
+          vertices_dirty_(false),
+          mirrored_(false),
+          normals_valid_(false) {
     }
 
     //! \brief Loads in an object file and populates the mesh from it.
@@ -29,37 +49,162 @@ class TriangleMesh {
     //! If the scale variable is set to false, the points read in from
     //! the object file will be treated as exact window coordinates and
     //! will not be scaled.
+    //!
+    //! The parsed mesh, its object-space normals and its adjacency are
+    //! written to a binary cache next to the file. Later loads of the same
+    //! file memory-map the cache instead of parsing the file again.
     void LoadFile(const char *filename, bool scale = true);
 
     //! \brief Returns the three vertices of a triangle.
     void GetTriangleVertices(int index, Vertex& v1, Vertex& v2, Vertex& v3);
 
-    //! \brief Returns the indices of the three vertices of a triangle.
-    void GetTriangleVerticesInt(int index, std::vector<int>&);
+    //! \brief Returns the world-space bounding box of the mesh.
+    //!
+    //! This is the box around the transformed corners of the object-space
+    //! bounding box, so it may be larger than the transformed mesh, but
+    //! needs none of the vertices to be transformed.
+    void GetBounds(Vertex& min, Vertex& max);
+
+    //! \brief Returns a triangle, whose vertices index positions() and the
+    //!        other per-vertex streams.
+    //!
+    //! Its vertices are wound counter-clockwise about its outward normal in
+    //! world space. If the model matrix mirrors the mesh, that is the reverse
+    //! of their order in the file.
+    inline const Triangle& triangle(int index) const {
+      return mesh_triangles_[index];
+    }
 
     //! \brief Applies a transformation matrix to the mesh points.
     //!
+    //! The transformation is applied about the centre of the mesh, and is
+    //! composed into the model matrix; no vertices are touched until they
+    //! are next read.
+    //!
     //! Return this object, in order to facilitate chaining.
-    TriangleMesh& ApplyTransformation(FloatMatrix transformation_matrix);
+    TriangleMesh& ApplyTransformation(const Mat4& transformation_matrix);
+
+    //! \brief Recomputes the world-space vertices if the model matrix has
+    //!        changed since they were last computed.
+    //!
+    //! Called by every function that reads vertices or normals, so calling it
+    //! directly is only needed to control when the work happens. Renderers
+    //! call it once per frame before starting any jobs that read the mesh,
+    //! as the update itself runs on the job system.
+    inline void UpdateVertices() {
+      if (vertices_dirty_.load(std::memory_order_acquire)) {
+        TransformVertices();
+      }
+    }
 
     inline int trigNum() {
       return mesh_triangles_.size();
     }
     inline int vNum() {
-      return mesh_vertices_.size();
+      return positions_.size();
     }
     inline Vertex v(int i) {
-      return mesh_vertices_[i];
+      UpdateVertices();
+      return positions_.Get(i);
+    }
+
+    //! \brief Returns the world-space position of every vertex.
+    inline const VertexStream& positions() {
+      UpdateVertices();
+      return positions_;
+    }
+
+    //! \brief Returns the texture coordinates (u, v, w) of each vertex, or an
+    //!        empty stream if the file gave none.
+    inline const VertexStream& texcoords() const {
+      return texcoords_;
     }
 
     //! \brief Returns the set of triangles that a vertex belongs to.
-    inline std::vector<int> GetTrianglesForVertex(int v) {
-      return vertices_to_triangles_[v];
+    //!
+    //! The span points into the mesh's adjacency, and is valid until the
+    //! next LoadFile().
+    inline Span<const int> GetTrianglesForVertex(int v) const {
+      const int begin = adjacency_offsets_[v];
+      return Span<const int>(adjacency_.data() + begin,
+          adjacency_offsets_[v + 1] - begin);
+    }
+
+    //! \brief Returns the unit surface normal of each triangle.
+    //!
+    //! The normals are computed on first use and cached until the mesh
+    //! changes.
+    inline const VertexStream& triangle_normals() {
+      UpdateVertices();
+      if (!normals_valid_) {
+        UpdateNormals();
+      }
+      return triangle_normals_;
+    }
+
+    //! \brief Returns the normal of each vertex.
+    //!
+    //! These are the normals given in the file, scaled to unit length, if it
+    //! gave them, and otherwise the average of the normals of the triangles
+    //! that the vertex belongs to. Cached in the same way as
+    //! triangle_normals().
+    inline const VertexStream& vertex_normals() {
+      UpdateVertices();
+      if (!normals_valid_) {
+        UpdateNormals();
+      }
+      return vertex_normals_;
     }
   private:
-    std::vector<Vertex> mesh_vertices_;
-    std::vector<Triangle> mesh_triangles_;
-    std::vector<std::vector<int> > vertices_to_triangles_;
+    //! Applies the model matrix to every object-space vertex.
+    void TransformVertices();
+
+    //! Recomputes the cached normals from the current vertex positions, or
+    //! from the model matrix for normals that the file gave.
+    void UpdateNormals();
+
+    //! Transforms the normals that the file gave into vertex_normals_.
+    void TransformSuppliedNormals();
+
+    //! The vertices as loaded, their centre and their bounding box.
+    VertexStream object_positions_;
+    Vertex object_centre_;
+    Vertex object_min_;
+    Vertex object_max_;
+
+    //! The vertices in world space, as of the last TransformVertices().
+    VertexStream positions_;
+
+    //! The normals given in the file, in object space, and the texture
+    //! coordinates. Either may be empty.
+    VertexStream object_normals_;
+    VertexStream texcoords_;
+    Buffer<Triangle> mesh_triangles_;
+
+    //! The triangles that each vertex belongs to, in compressed sparse row
+    //! form: those of vertex v are adjacency_[adjacency_offsets_[v]] up to
+    //! adjacency_[adjacency_offsets_[v + 1]].
+    Buffer<int> adjacency_offsets_;
+    Buffer<int> adjacency_;
+
+    //! Maps object space to world space.
+    Mat4 model_matrix_;
+
+    //! The transformations applied since the world-space vertices were last
+    //! computed, and whether they amount to a rotation.
+    Mat4 pending_matrix_;
+    bool pending_rotation_;
+
+    std::atomic<bool> vertices_dirty_;
+    std::mutex update_mutex_;
+
+    //! Whether the winding of mesh_triangles_ has been reversed, because the
+    //! model matrix mirrors the mesh.
+    bool mirrored_;
+
+    VertexStream triangle_normals_;
+    VertexStream vertex_normals_;
+    bool normals_valid_;
 };
 }
 
@@ -4,7 +4,7 @@
 
 namespace computer_graphics {
 
-Vertex& Vertex::operator=(Vertex &other) {
+Vertex& Vertex::operator=(const Vertex &other) {
   coordinates_[0] = other[0];
   coordinates_[1] = other[1];
   coordinates_[2] = other[2];
@@ -12,7 +12,7 @@ Vertex& Vertex::operator=(Vertex &other) {
   return *this;
 }
 
-Vertex& Vertex::operator+=(Vertex &other) {
+Vertex& Vertex::operator+=(const Vertex &other) {
   coordinates_[0] += other[0];
   coordinates_[1] += other[1];
   coordinates_[2] += other[2];
@@ -24,4 +24,8 @@ float& Vertex::operator[] (int index) {
   return coordinates_[index];
 }
 
+float Vertex::operator[] (int index) const {
+  return coordinates_[index];
+}
+
 }  // namespace computer_graphics
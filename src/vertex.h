@@ -38,9 +38,10 @@ class Vertex {
       blue_ = b;
     }
 
-    Vertex & operator= (Vertex &other);
-    Vertex & operator+= (Vertex &other);
+    Vertex & operator= (const Vertex &other);
+    Vertex & operator+= (const Vertex &other);
     float& operator[] (int i);
+    float operator[] (int i) const;
 
     inline void set_x(float x) { coordinates_[0] = x; }
     inline void set_y(float y) { coordinates_[1] = y; }
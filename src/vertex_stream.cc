@@ -0,0 +1,107 @@
+//! \author Stephen McGruer
+
+#include "./vertex_stream.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace computer_graphics {
+
+void VertexStream::resize(int size) {
+  x_.resize(size);
+  y_.resize(size);
+  z_.resize(size);
+}
+
+void VertexStream::clear() {
+  x_.clear();
+  y_.clear();
+  z_.clear();
+}
+
+void VertexStream::push_back(float x, float y, float z) {
+  x_.push_back(x);
+  y_.push_back(y);
+  z_.push_back(z);
+}
+
+void TransformPoints(const Mat4& matrix, const VertexStream& in, int begin,
+    int end, VertexStream& out) {
+  const float* in_x = in.x().data();
+  const float* in_y = in.y().data();
+  const float* in_z = in.z().data();
+  float* out_x = out.x().data();
+  float* out_y = out.y().data();
+  float* out_z = out.z().data();
+
+  int i = begin;
+#if defined(__SSE__)
+  // Four points at a time. The products are summed in the same order as
+  // Mat4 * Vec4, so the results match the scalar loop below exactly.
+  __m128 m[4][4];
+  for (int row = 0; row < 4; row++) {
+    for (int col = 0; col < 4; col++) {
+      m[row][col] = _mm_set1_ps(matrix(row, col));
+    }
+  }
+
+  for (; i + 4 <= end; i += 4) {
+    __m128 x = _mm_loadu_ps(in_x + i);
+    __m128 y = _mm_loadu_ps(in_y + i);
+    __m128 z = _mm_loadu_ps(in_z + i);
+
+    __m128 result[4];
+    for (int row = 0; row < 4; row++) {
+      __m128 sum = _mm_mul_ps(m[row][0], x);
+      sum = _mm_add_ps(sum, _mm_mul_ps(m[row][1], y));
+      sum = _mm_add_ps(sum, _mm_mul_ps(m[row][2], z));
+      result[row] = _mm_add_ps(sum, m[row][3]);
+    }
+
+    _mm_storeu_ps(out_x + i, _mm_div_ps(result[0], result[3]));
+    _mm_storeu_ps(out_y + i, _mm_div_ps(result[1], result[3]));
+    _mm_storeu_ps(out_z + i, _mm_div_ps(result[2], result[3]));
+  }
+#endif
+
+  for (; i < end; i++) {
+    Vec4 result = matrix * Vec4(in_x[i], in_y[i], in_z[i], 1.0f);
+    out_x[i] = result.x() / result.w();
+    out_y[i] = result.y() / result.w();
+    out_z[i] = result.z() / result.w();
+  }
+}
+
+void RotateDirections(const Mat4& m, int begin, int end,
+    VertexStream& directions) {
+  float* x = directions.x().data();
+  float* y = directions.y().data();
+  float* z = directions.z().data();
+
+  // Simple enough for the compiler to vectorise on its own.
+  for (int i = begin; i < end; i++) {
+    float old_x = x[i];
+    float old_y = y[i];
+    float old_z = z[i];
+    x[i] = m(0, 0) * old_x + m(0, 1) * old_y + m(0, 2) * old_z;
+    y[i] = m(1, 0) * old_x + m(1, 1) * old_y + m(1, 2) * old_z;
+    z[i] = m(2, 0) * old_x + m(2, 1) * old_y + m(2, 2) * old_z;
+  }
+}
+
+void GatherVertices(const VertexStream& in, const int* indices, int begin,
+    int end, VertexStream& out) {
+  const float* in_x = in.x().data();
+  const float* in_y = in.y().data();
+  const float* in_z = in.z().data();
+  float* out_x = out.x().data();
+  float* out_y = out.y().data();
+  float* out_z = out.z().data();
+  for (int i = begin; i < end; i++) {
+    out_x[i] = in_x[indices[i]];
+    out_y[i] = in_y[indices[i]];
+    out_z[i] = in_z[indices[i]];
+  }
+}
+}  // namespace computer_graphics
@@ -0,0 +1,131 @@
+//! \author Stephen McGruer
+
+#ifndef SRC_VERTEXSTREAM_H_
+#define SRC_VERTEXSTREAM_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "./buffer.h"
+#include "./mat4.h"
+#include "./vertex.h"
+
+namespace computer_graphics {
+
+//! \class Span
+//! \brief A view of a contiguous run of elements owned by something else.
+template <typename T>
+class Span {
+  public:
+    Span(T* data, size_t size)
+        : data_(data),
+          size_(size) {
+    }
+
+    //! Allows a Span<T> to be viewed as a Span<const T>.
+    template <typename U>
+    Span(const Span<U>& other)
+        : data_(other.data()),
+          size_(other.size()) {
+    }
+
+    inline T* data() const { return data_; }
+    inline size_t size() const { return size_; }
+    inline T& operator[](size_t i) const { return data_[i]; }
+
+    inline T* begin() const { return data_; }
+    inline T* end() const { return data_ + size_; }
+
+  private:
+    T* data_;
+    size_t size_;
+};
+
+//! \class VertexStream
+//! \brief Three-component vertex data (positions or normals), stored as
+//!        separate aligned x, y and z arrays.
+//!
+//! Keeping each component contiguous lets the transform and projection
+//! kernels work on several vertices per instruction, and stores 12 bytes per
+//! vertex rather than the 24 of a Vertex.
+//!
+//! Like a Buffer, a stream may view components held elsewhere, such as in a
+//! memory-mapped mesh cache.
+class VertexStream {
+  public:
+    VertexStream() {
+    }
+
+    //! \brief Returns a stream that views size vertices' components at x, y
+    //!        and z, which owner keeps alive.
+    static VertexStream View(float* x, float* y, float* z, int size,
+        const std::shared_ptr<const void>& owner) {
+      VertexStream stream;
+      stream.x_ = Buffer<float>::View(x, size, owner);
+      stream.y_ = Buffer<float>::View(y, size, owner);
+      stream.z_ = Buffer<float>::View(z, size, owner);
+      return stream;
+    }
+
+    inline int size() const { return x_.size(); }
+
+    void resize(int size);
+    void clear();
+    void push_back(float x, float y, float z);
+
+    inline Span<const float> x() const { return View(x_); }
+    inline Span<const float> y() const { return View(y_); }
+    inline Span<const float> z() const { return View(z_); }
+    inline Span<float> x() { return View(x_); }
+    inline Span<float> y() { return View(y_); }
+    inline Span<float> z() { return View(z_); }
+
+    //! Gathers one vertex's components into a Vertex.
+    inline Vertex Get(int i) const { return Vertex(x_[i], y_[i], z_[i]); }
+
+    inline void Set(int i, float x, float y, float z) {
+      x_[i] = x;
+      y_[i] = y;
+      z_[i] = z;
+    }
+
+  private:
+    typedef Buffer<float> Array;
+
+    static inline Span<const float> View(const Array& array) {
+      return Span<const float>(array.data(), array.size());
+    }
+    static inline Span<float> View(Array& array) {
+      return Span<float>(array.data(), array.size());
+    }
+
+    Array x_;
+    Array y_;
+    Array z_;
+};
+
+//! The number of vertices that the stream kernels are handed at a time when
+//! a stream is split across threads.
+const int kStreamBlockSize = 1024;
+
+//! \brief Transforms the points in [begin, end) of in by a matrix, dividing
+//!        through by w, and writes them to the same positions in out.
+//!
+//! out must already be at least as large as in.
+void TransformPoints(const Mat4& matrix, const VertexStream& in, int begin,
+    int end, VertexStream& out);
+
+//! \brief Rotates the directions in [begin, end) of a stream in place by
+//!        the upper 3x3 of a matrix.
+void RotateDirections(const Mat4& matrix, int begin, int end,
+    VertexStream& directions);
+
+//! \brief Copies element indices[i] of in to element i of out, for each i
+//!        in [begin, end).
+//!
+//! out must already be at least end long.
+void GatherVertices(const VertexStream& in, const int* indices, int begin,
+    int end, VertexStream& out);
+}  // namespace computer_graphics
+
+#endif  // SRC_VERTEXSTREAM_H_